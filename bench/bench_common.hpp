@@ -0,0 +1,28 @@
+// Copyright Antony Polukhin, 2015-2024.
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <exception>
+
+#include <midll/midll.hpp>
+
+namespace midll_bench
+{
+
+// Libraries under test are built next to the benchmark executable
+inline midll::fs::path library_path(const char* name)
+{
+    return midll::program_location().parent_path() / midll::shared_library::decorate(name);
+}
+
+// Large binary that is already loaded into the process: the C++ runtime
+inline midll::fs::path runtime_library_path()
+{
+    return midll::symbol_location_ptr(&std::terminate);
+}
+
+} // namespace midll_bench
@@ -0,0 +1,56 @@
+// Copyright Antony Polukhin, 2015-2024.
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#include <benchmark/benchmark.h>
+
+#include "bench_common.hpp"
+
+// Same operations as in the benchmarks of bench_shared_library.cpp, but performed by several threads at once on the
+// same libraries. See also the midll_stress executable for the latency percentiles.
+
+namespace
+{
+
+void contended_load_unload(benchmark::State& state)
+{
+    const midll::fs::path path = midll_bench::library_path("test_library");
+    for (auto _ : state) {
+        midll::shared_library sl(path);
+        benchmark::DoNotOptimize(sl.native());
+    }
+}
+BENCHMARK(contended_load_unload)->ThreadRange(1, 8)->UseRealTime();
+
+void contended_copy(benchmark::State& state)
+{
+    static const midll::shared_library sl(midll_bench::library_path("test_library"));
+    for (auto _ : state) {
+        midll::shared_library copy(sl);
+        benchmark::DoNotOptimize(copy.native());
+    }
+}
+BENCHMARK(contended_copy)->ThreadRange(1, 8)->UseRealTime();
+
+void contended_get(benchmark::State& state)
+{
+    static const midll::shared_library sl(midll_bench::library_path("test_library"));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(&sl.get<int>("integer_g"));
+    }
+}
+BENCHMARK(contended_get)->ThreadRange(1, 8)->UseRealTime();
+
+void contended_import_symbol(benchmark::State& state)
+{
+    static const midll::shared_library sl(midll_bench::library_path("test_library"));
+    for (auto _ : state) {
+        auto f = midll::import_symbol<int(int)>(sl, "increment");
+        benchmark::DoNotOptimize(f(1));
+    }
+}
+BENCHMARK(contended_import_symbol)->ThreadRange(1, 8)->UseRealTime();
+
+} // namespace
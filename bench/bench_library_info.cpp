@@ -0,0 +1,52 @@
+// Copyright Antony Polukhin, 2015-2024.
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#include <benchmark/benchmark.h>
+
+#include "bench_common.hpp"
+
+namespace
+{
+
+// Argument: 0 for the small test_library, 1 for the C++ runtime library
+midll::fs::path binary(const benchmark::State& state)
+{
+    return (state.range(0) ? midll_bench::runtime_library_path() : midll_bench::library_path("test_library"));
+}
+
+void library_info_construct(benchmark::State& state)
+{
+    const midll::fs::path path = binary(state);
+    for (auto _ : state) {
+        midll::library_info info(path);
+        benchmark::DoNotOptimize(&info);
+    }
+}
+BENCHMARK(library_info_construct)->Arg(0)->Arg(1)->ArgName("large");
+
+void library_info_sections(benchmark::State& state)
+{
+    midll::library_info info(binary(state));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(info.sections());
+    }
+}
+BENCHMARK(library_info_sections)->Arg(0)->Arg(1)->ArgName("large");
+
+void library_info_symbols(benchmark::State& state)
+{
+    midll::library_info info(binary(state));
+    std::size_t count = 0;
+    for (auto _ : state) {
+        const std::vector<std::string> symbols = info.symbols();
+        count = symbols.size();
+        benchmark::DoNotOptimize(symbols.data());
+    }
+    state.counters["symbols"] = static_cast<double>(count);
+}
+BENCHMARK(library_info_symbols)->Arg(0)->Arg(1)->ArgName("large");
+
+} // namespace
@@ -0,0 +1,198 @@
+// Copyright Antony Polukhin, 2015-2024.
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#include <benchmark/benchmark.h>
+
+#include "bench_common.hpp"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+const midll::load_mode::type modes[] = {
+    midll::load_mode::rtld_lazy | midll::load_mode::rtld_local,
+    midll::load_mode::rtld_now | midll::load_mode::rtld_local,
+    midll::load_mode::rtld_lazy | midll::load_mode::rtld_global,
+    midll::load_mode::rtld_now | midll::load_mode::rtld_global,
+};
+
+const char* const libraries[] = {"empty_library", "test_library"};
+
+// Arguments: index in `modes`, index in `libraries`
+void load_unload(benchmark::State& state)
+{
+    const midll::load_mode::type mode = modes[state.range(0)];
+    const midll::fs::path path = midll_bench::library_path(libraries[state.range(1)]);
+    for (auto _ : state) {
+        midll::shared_library sl(path, mode);
+        benchmark::DoNotOptimize(sl.native());
+    }
+}
+BENCHMARK(load_unload)->ArgsProduct({{0, 1, 2, 3}, {0, 1}})->ArgNames({"mode", "library"});
+
+// Same as above, but the library is kept loaded by another instance
+void load_loaded(benchmark::State& state)
+{
+    const midll::fs::path path = midll_bench::library_path("test_library");
+    const midll::shared_library keep(path);
+    for (auto _ : state) {
+        midll::shared_library sl(path);
+        benchmark::DoNotOptimize(sl.native());
+    }
+}
+BENCHMARK(load_loaded);
+
+void get_hit(benchmark::State& state)
+{
+    const midll::shared_library sl(midll_bench::library_path("test_library"));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(&sl.get<int>("integer_g"));
+    }
+}
+BENCHMARK(get_hit);
+
+void get_miss(benchmark::State& state)
+{
+    const midll::shared_library sl(midll_bench::library_path("test_library"));
+    for (auto _ : state) {
+        try {
+            benchmark::DoNotOptimize(&sl.get<int>("symbol_that_does_not_exist"));
+        }
+        catch (const midll::fs::system_error&) {
+        }
+    }
+}
+BENCHMARK(get_miss);
+
+void try_get_miss(benchmark::State& state)
+{
+    const midll::shared_library sl(midll_bench::library_path("test_library"));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(sl.try_get<int>("symbol_that_does_not_exist"));
+    }
+}
+BENCHMARK(try_get_miss);
+
+void has_hit(benchmark::State& state)
+{
+    const midll::shared_library sl(midll_bench::library_path("test_library"));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(sl.has("integer_g"));
+    }
+}
+BENCHMARK(has_hit);
+
+void has_miss(benchmark::State& state)
+{
+    const midll::shared_library sl(midll_bench::library_path("test_library"));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(sl.has("symbol_that_does_not_exist"));
+    }
+}
+BENCHMARK(has_miss);
+
+void import_symbol_construct(benchmark::State& state)
+{
+    const midll::shared_library sl(midll_bench::library_path("test_library"));
+    for (auto _ : state) {
+        auto f = midll::import_symbol<int(int)>(sl, "increment");
+        benchmark::DoNotOptimize(f);
+    }
+}
+BENCHMARK(import_symbol_construct);
+
+void import_alias_construct(benchmark::State& state)
+{
+    const midll::shared_library sl(midll_bench::library_path("test_library"));
+    for (auto _ : state) {
+        auto f = midll::import_alias<std::size_t(const std::vector<int>&)>(sl, "foo_bar");
+        benchmark::DoNotOptimize(f);
+    }
+}
+BENCHMARK(import_alias_construct);
+
+void call_raw_pointer(benchmark::State& state)
+{
+    const midll::shared_library sl(midll_bench::library_path("test_library"));
+    int (*f)(int) = &sl.get<int(int)>("increment");
+    int i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(f);
+        i = f(i);
+    }
+    benchmark::DoNotOptimize(i);
+}
+BENCHMARK(call_raw_pointer);
+
+void call_import_symbol(benchmark::State& state)
+{
+    const auto f = midll::import_symbol<int(int)>(midll_bench::library_path("test_library"), "increment");
+    int i = 0;
+    for (auto _ : state) {
+        i = f(i);
+    }
+    benchmark::DoNotOptimize(i);
+}
+BENCHMARK(call_import_symbol);
+
+void call_import_alias(benchmark::State& state)
+{
+    const auto f =
+        midll::import_alias<std::size_t(const std::vector<int>&)>(midll_bench::library_path("test_library"), "foo_bar");
+    const std::vector<int> v(3);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(f(v));
+    }
+}
+BENCHMARK(call_import_alias);
+
+void copy(benchmark::State& state)
+{
+    const midll::shared_library sl(midll_bench::library_path("test_library"));
+    for (auto _ : state) {
+        midll::shared_library copy(sl);
+        benchmark::DoNotOptimize(copy.native());
+    }
+}
+BENCHMARK(copy);
+
+void assign(benchmark::State& state)
+{
+    // Assigning the same library is a no-op, so the iterations alternate between two libraries
+    const midll::shared_library libs[] = {midll::shared_library(midll_bench::library_path("test_library")),
+                                          midll::shared_library(midll_bench::library_path("empty_library"))};
+    midll::shared_library other;
+    std::size_t i = 0;
+    for (auto _ : state) {
+        other = libs[++i & 1];
+        benchmark::DoNotOptimize(other.native());
+    }
+}
+BENCHMARK(assign);
+
+void location(benchmark::State& state)
+{
+    const midll::shared_library sl(midll_bench::library_path("test_library"));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(sl.location());
+    }
+}
+BENCHMARK(location);
+
+void symbol_location_ptr(benchmark::State& state)
+{
+    const midll::shared_library sl(midll_bench::library_path("test_library"));
+    const int* const symbol = &sl.get<int>("integer_g");
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(midll::symbol_location_ptr(symbol));
+    }
+}
+BENCHMARK(symbol_location_ptr);
+
+} // namespace
@@ -0,0 +1,111 @@
+// Copyright Antony Polukhin, 2015-2024.
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#include <benchmark/benchmark.h>
+
+#include "bench_common.hpp"
+
+#include <string>
+#include <vector>
+
+// Libraries are generated by midll_add_synthetic_library() from cmake/MidllSyntheticLibrary.cmake
+
+namespace
+{
+
+struct synthetic_library
+{
+    const char* name;
+    unsigned symbols;
+    const char* suffix;
+    bool mangled;
+};
+
+const synthetic_library synthetic_libraries[] = {
+    {"synthetic_1k", 1000, "", false},
+    {"synthetic_10k", 10000, "", false},
+    {"synthetic_100k", 100000, "", false},
+    {"synthetic_10k_mangled", 10000, "", true},
+    {"synthetic_10k_long", 10000, MIDLL_SYNTHETIC_LONG_SUFFIX, false},
+    {"synthetic_10k_stripped", 10000, "", false},
+};
+
+// Name of the exported `int (int)` function `id`. Mangled names follow the Itanium C++ ABI, `has_hit` reports an
+// error on the platforms with other mangling schemes.
+std::string function_name(const synthetic_library& lib, const std::string& id)
+{
+    if (lib.mangled) {
+        const std::string name = "function_" + id + lib.suffix;
+        return "_ZN15midll_synthetic" + std::to_string(name.size()) + name + "Ei";
+    }
+    return "synthetic_function_" + id + lib.suffix;
+}
+
+void load_unload(benchmark::State& state, const synthetic_library& lib)
+{
+    const midll::fs::path path = midll_bench::library_path(lib.name);
+    for (auto _ : state) {
+        midll::shared_library sl(path, midll::load_mode::rtld_now);
+        benchmark::DoNotOptimize(sl.native());
+    }
+}
+
+void library_info_symbols(benchmark::State& state, const synthetic_library& lib)
+{
+    midll::library_info info(midll_bench::library_path(lib.name));
+    std::size_t count = 0;
+    for (auto _ : state) {
+        const std::vector<std::string> symbols = info.symbols();
+        count = symbols.size();
+        benchmark::DoNotOptimize(symbols.data());
+    }
+    state.counters["symbols"] = static_cast<double>(count);
+}
+
+void library_info_sections(benchmark::State& state, const synthetic_library& lib)
+{
+    midll::library_info info(midll_bench::library_path(lib.name));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(info.sections());
+    }
+}
+
+void has_hit(benchmark::State& state, const synthetic_library& lib)
+{
+    const midll::shared_library sl(midll_bench::library_path(lib.name));
+    const std::string name = function_name(lib, std::to_string(lib.symbols / 4));
+    if (!sl.has(name)) {
+        state.SkipWithError("symbol not found");
+        return;
+    }
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(sl.has(name));
+    }
+}
+
+void has_miss(benchmark::State& state, const synthetic_library& lib)
+{
+    const midll::shared_library sl(midll_bench::library_path(lib.name));
+    const std::string name = function_name(lib, "that_does_not_exist");
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(sl.has(name));
+    }
+}
+
+const bool registered = []() {
+    for (const synthetic_library& lib : synthetic_libraries) {
+        const std::string suffix = std::string("/") + lib.name;
+        benchmark::RegisterBenchmark(("synthetic_load_unload" + suffix).c_str(), load_unload, lib);
+        benchmark::RegisterBenchmark(("synthetic_library_info_symbols" + suffix).c_str(), library_info_symbols, lib);
+        benchmark::RegisterBenchmark(("synthetic_library_info_sections" + suffix).c_str(), library_info_sections, lib);
+        benchmark::RegisterBenchmark(("synthetic_has_hit" + suffix).c_str(), has_hit, lib);
+        benchmark::RegisterBenchmark(("synthetic_has_miss" + suffix).c_str(), has_miss, lib);
+    }
+    return true;
+}();
+
+} // namespace
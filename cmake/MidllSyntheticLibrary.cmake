@@ -0,0 +1,116 @@
+# Generator of shared libraries with a large count of exported symbols, for the scaling tests and benchmarks.
+#
+# midll_add_synthetic_library(<target> SYMBOLS <count>
+#                             [MANGLED] [LONG_NAMES] [SECTIONS <count>] [STRIPPED]
+#                             [TEXT_PADDING <bytes>])
+#
+# Creates a shared library target that exports <count> symbols: <count>/2 functions `int (int)` and <count>/2
+# variables `int`. Function number i returns its argument plus i, variable number i is initialized with i.
+#
+#   MANGLED     Symbols are C++ functions and variables in the `midll_synthetic` namespace instead of the
+#               `extern "C"` `synthetic_function_<i>` and `synthetic_variable_<i>`.
+#   LONG_NAMES  Names get a suffix of about 150 characters, see MIDLL_SYNTHETIC_LONG_SUFFIX.
+#   SECTIONS    Variables are spread round robin over the sections `synth0` ... `synth<count - 1>` via MIDLL_SECTION.
+#   STRIPPED    Static symbol table is removed after the build, only the dynamic symbols remain.
+#   TEXT_PADDING Code of the functions is surrounded by <bytes> of unused bytes in `.text` on each side, so that a
+#               padding of 2 MiB puts the functions into a 2 MiB aligned part of the code segment. GCC and Clang only.
+
+set(MIDLL_SYNTHETIC_LONG_SUFFIX
+    "_with_a_rather_long_name_that_makes_the_string_table_of_the_binary_noticeably_larger_and_the_hashing_of_the_name_slower_than_usual")
+
+function(midll_add_synthetic_library target)
+    cmake_parse_arguments(ARG "MANGLED;LONG_NAMES;STRIPPED" "SYMBOLS;SECTIONS;TEXT_PADDING" "" ${ARGN})
+    if (NOT ARG_SYMBOLS OR ARG_SYMBOLS LESS 2)
+        message(FATAL_ERROR "midll_add_synthetic_library(${target}): SYMBOLS must be at least 2")
+    endif()
+    if (NOT ARG_SECTIONS)
+        set(ARG_SECTIONS 0)
+    endif()
+
+    # Token pasting of the number and an empty suffix would not compile
+    set(suffix "")
+    if (ARG_LONG_NAMES)
+        set(suffix "##${MIDLL_SYNTHETIC_LONG_SUFFIX}")
+    endif()
+
+    # Definitions are put into a namespace or into an `extern "C"` block, a per definition `extern "C"` would make
+    # the compiler warn about the initialized variables
+    if (ARG_MANGLED)
+        set(open_namespace "namespace midll_synthetic {")
+        set(close_namespace "}")
+        set(function_prefix "function_")
+        set(variable_prefix "variable_")
+    else()
+        set(open_namespace "extern \"C\" {")
+        set(close_namespace "}")
+        set(function_prefix "synthetic_function_")
+        set(variable_prefix "synthetic_variable_")
+    endif()
+
+    # Each symbol is a single macro invocation, so that the generation stays fast for 100k symbols
+    set(content "// Generated by midll_add_synthetic_library(), do not edit\n\n#include <midll/alias.hpp>\n#include <midll/config.hpp>\n\n")
+    set(function_name "${function_prefix}##i${suffix}")
+    set(variable_name "${variable_prefix}##i${suffix}")
+    string(APPEND content "#define MIDLL_SYNTHETIC_FUNCTION(i) MIDLL_SYMBOL_EXPORT int ${function_name}(int x) { return x + i; }\n")
+    string(APPEND content "#define MIDLL_SYNTHETIC_VARIABLE(i) MIDLL_SYMBOL_EXPORT int ${variable_name} = i;\n")
+    string(APPEND content "#define MIDLL_SYNTHETIC_SECTIONED_VARIABLE(i, s) extern MIDLL_SYMBOL_EXPORT int ${variable_name}; MIDLL_SECTION(s, write) int ${variable_name} = i;\n\n")
+    string(APPEND content "${open_namespace}\n")
+
+    set(source ${CMAKE_CURRENT_BINARY_DIR}/${target}.cpp)
+    file(WRITE ${source}.tmp "${content}")
+
+    math(EXPR half "${ARG_SYMBOLS} / 2")
+    math(EXPR last "${half} - 1")
+    set(chunk "")
+    foreach (i RANGE ${last})
+        if (ARG_SECTIONS GREATER 0)
+            math(EXPR section "${i} % ${ARG_SECTIONS}")
+            string(APPEND chunk "MIDLL_SYNTHETIC_FUNCTION(${i}) MIDLL_SYNTHETIC_SECTIONED_VARIABLE(${i}, synth${section})\n")
+        else()
+            string(APPEND chunk "MIDLL_SYNTHETIC_FUNCTION(${i}) MIDLL_SYNTHETIC_VARIABLE(${i})\n")
+        endif()
+
+        math(EXPR in_chunk "${i} % 1000")
+        if (in_chunk EQUAL 999)
+            file(APPEND ${source}.tmp "${chunk}")
+            set(chunk "")
+        endif()
+    endforeach()
+    file(APPEND ${source}.tmp "${chunk}${close_namespace}\n")
+
+    # Touching the source only on changes keeps the library from being rebuilt on each configure
+    configure_file(${source}.tmp ${source} COPYONLY)
+    file(REMOVE ${source}.tmp)
+
+    # Objects are linked in the order of the sources, so the paddings end up before and after the functions
+    set(sources ${source})
+    if (ARG_TEXT_PADDING)
+        set(padding_content "// Generated by midll_add_synthetic_library(), do not edit\n\n__asm__(\".pushsection .text\\n\\t.skip ${ARG_TEXT_PADDING}\\n\\t.popsection\");\n")
+        foreach (side begin end)
+            set(padding_source ${CMAKE_CURRENT_BINARY_DIR}/${target}_padding_${side}.cpp)
+            file(WRITE ${padding_source}.tmp "${padding_content}")
+            configure_file(${padding_source}.tmp ${padding_source} COPYONLY)
+            file(REMOVE ${padding_source}.tmp)
+        endforeach()
+        set(sources
+            ${CMAKE_CURRENT_BINARY_DIR}/${target}_padding_begin.cpp
+            ${source}
+            ${CMAKE_CURRENT_BINARY_DIR}/${target}_padding_end.cpp
+        )
+    endif()
+
+    add_library(${target} SHARED ${sources})
+    target_link_libraries(${target} PRIVATE midll)
+
+    if (ARG_STRIPPED AND CMAKE_STRIP AND NOT MSVC)
+        if (APPLE)
+            set(strip_flags -x)
+        else()
+            set(strip_flags --strip-unneeded)
+        endif()
+        add_custom_command(TARGET ${target} POST_BUILD
+            COMMAND ${CMAKE_STRIP} ${strip_flags} $<TARGET_FILE:${target}>
+            VERBATIM
+        )
+    endif()
+endfunction()
@@ -0,0 +1,199 @@
+// Copyright Antony Polukhin, 2015-2024.
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+#include <midll/config.hpp>
+#include <midll/detail/system_error.hpp>
+#include <midll/loaded_modules.hpp>
+
+/// \file midll/address_resolver.hpp
+/// \brief Contains only the midll::address_resolver class for fast address to binary lookups.
+
+namespace midll
+{
+
+/*!
+ * \brief Finds the binary that holds an address, like \forcedlink{symbol_location_ptr} does, but without a
+ * `dladdr` call and a path construction per query.
+ *
+ * Keeps a sorted table of the segments of all the loaded binaries, so a lookup is a binary search. Checking
+ * \forcedlink{loaded_modules_generation} takes the dynamic linker lock, so resolve() does it only on a miss and once
+ * per `check_interval` lookups: an address in a binary that was loaded after the last rebuild is always found, while
+ * an address of a binary that was unloaded may be reported with the name of that binary for up to `check_interval`
+ * lookups.
+ *
+ * Names of the binaries are interned: returned string views stay valid for the lifetime of the resolver, even after
+ * the binary is unloaded. Interned names are never freed, so the memory grows with the count of distinct binaries
+ * ever seen by the resolver.
+ *
+ * The class is not thread safe, use an instance per thread or an external synchronization.
+ *
+ * \b Example:
+ * \code
+ * thread_local midll::address_resolver resolver;
+ * std::string_view binary = resolver.resolve(return_address); // "/usr/lib/libplugin.so"
+ * \endcode
+ */
+class address_resolver
+{
+    struct interval
+    {
+        std::uintptr_t begin;
+        std::uintptr_t end;
+        std::string_view name;
+    };
+
+    std::vector<interval> table_;
+    std::unordered_set<std::string> names_;
+    std::uint64_t generation_ = 0;
+    std::uint32_t check_interval_;
+    std::uint32_t unchecked_lookups_ = 0;
+    bool initialized_ = false;
+
+public:
+    /*!
+     * \param check_interval Count of the lookups after which resolve() checks that the table is up to date even if
+     * the address was found. 1 checks on every lookup.
+     * \throw Nothing.
+     */
+    explicit address_resolver(std::uint32_t check_interval = 1024) noexcept
+        : check_interval_(check_interval ? check_interval : 1)
+    {
+    }
+
+    address_resolver(const address_resolver&) = delete;
+    address_resolver& operator=(const address_resolver&) = delete;
+
+    address_resolver(address_resolver&&) = default;
+    address_resolver& operator=(address_resolver&&) = default;
+
+    /*!
+     * Rebuilds the table of segments from a new \forcedlink{loaded_modules} snapshot.
+     *
+     * \param ec Variable that will be set to the result of the operation.
+     * \throw std::bad_alloc in case of insufficient memory.
+     */
+    void refresh(midll::fs::error_code& ec)
+    {
+        const loaded_modules_snapshot snapshot = midll::loaded_modules(ec);
+        if (ec) {
+            return;
+        }
+
+        table_.clear();
+        table_.reserve(snapshot.segments().size());
+        for (const loaded_module& m : snapshot.modules()) {
+            const std::string_view name = *names_.insert(m.name).first;
+            for (auto it = snapshot.segments_begin(m); it != snapshot.segments_end(m); ++it) {
+                table_.push_back(interval{it->begin, it->end, name});
+            }
+        }
+        std::sort(table_.begin(), table_.end(),
+                  [](const interval& l, const interval& r) { return l.begin < r.begin; });
+
+        generation_ = snapshot.generation();
+        unchecked_lookups_ = 0;
+        initialized_ = true;
+    }
+
+    /*!
+     * Rebuilds the table of segments if any binary was loaded or unloaded since the last rebuild.
+     *
+     * \param ec Variable that will be set to the result of the operation.
+     * \throw std::bad_alloc in case of insufficient memory.
+     */
+    void refresh_if_stale(midll::fs::error_code& ec)
+    {
+        ec.clear();
+        unchecked_lookups_ = 0;
+        if (!initialized_ || generation_ != midll::loaded_modules_generation()) {
+            refresh(ec);
+        }
+    }
+
+    /*!
+     * Looks for the binary that holds `ptr` in the current table without checking that the table is up to date.
+     *
+     * \return Path to the binary or empty string view if `ptr` does not belong to any binary.
+     * \throw Nothing.
+     */
+    std::string_view find(const void* ptr) const noexcept
+    {
+        const std::uintptr_t p = reinterpret_cast<std::uintptr_t>(ptr);
+        auto it = std::upper_bound(table_.begin(), table_.end(), p,
+                                   [](std::uintptr_t value, const interval& i) { return value < i.begin; });
+        if (it == table_.begin()) {
+            return {};
+        }
+
+        --it;
+        return (p < it->end ? it->name : std::string_view{});
+    }
+
+    /*!
+     * Returns path to the binary that holds `ptr`, rebuilding the table of segments if it is stale. Staleness is
+     * checked if `ptr` is not in the table or once per `check_interval` lookups, see the class description.
+     *
+     * \param ptr Pointer to a symbol or any other address in a binary.
+     * \param ec Variable that will be set to the result of the operation.
+     * \return Path to the binary or empty string view in case of error.
+     * \throw std::bad_alloc in case of insufficient memory. Overload that does not accept \forcedlinkfs{error_code}
+     * also throws \forcedlinkfs{system_error}.
+     */
+    std::string_view resolve(const void* ptr, midll::fs::error_code& ec)
+    {
+        ec.clear();
+        bool checked = false;
+        if (!initialized_ || ++unchecked_lookups_ >= check_interval_) {
+            refresh_if_stale(ec);
+            if (ec) {
+                return {};
+            }
+            checked = true;
+        }
+
+        std::string_view name = find(ptr);
+        if (name.empty() && !checked) {
+            // Probably a binary loaded after the last rebuild
+            refresh_if_stale(ec);
+            if (ec) {
+                return {};
+            }
+            name = find(ptr);
+        }
+
+        if (name.empty()) {
+            ec = midll::fs::make_error_code(midll::fs::errc::bad_address);
+        }
+
+        return name;
+    }
+
+    //! \overload std::string_view resolve(const void* ptr, midll::fs::error_code& ec)
+    std::string_view resolve(const void* ptr)
+    {
+        midll::fs::error_code ec;
+        const std::string_view name = resolve(ptr, ec);
+        if (ec) {
+            midll::detail::report_error(ec, "midll::address_resolver::resolve() failed");
+        }
+
+        return name;
+    }
+
+    /// \return Count of the segments in the current table.
+    std::size_t size() const noexcept { return table_.size(); }
+};
+
+} // namespace midll
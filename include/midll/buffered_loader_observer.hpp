@@ -0,0 +1,341 @@
+// Copyright Antony Polukhin, 2015-2024.
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include <midll/config.hpp>
+#include <midll/loader_observer.hpp>
+
+/// \file midll/buffered_loader_observer.hpp
+/// \brief Contains the midll::buffered_loader_observer class that stores loader events into per thread buffers.
+
+namespace midll
+{
+
+/*!
+ * \brief Loader event stored by midll::buffered_loader_observer.
+ */
+struct loader_event_record
+{
+    enum kind_t
+    {
+        load,   ///< Library load, see load_event
+        symbol, ///< Symbol lookup, see symbol_event
+        unload  ///< Library unload, see unload_event
+    };
+
+    /// Kind of the event
+    kind_t kind = load;
+
+    /// Resolved path (requested path if the load failed) for loads, symbol name for lookups, empty for unloads
+    std::string name;
+
+    /// Mode of the load, default_mode for other events
+    load_mode::type mode = load_mode::default_mode;
+
+    /// Result of the load, `invalid_seek` for missing symbols
+    midll::fs::error_code ec;
+
+    /// Handle of the library
+    void* native_handle = nullptr;
+
+    /// Time when the operation started
+    loader_clock::time_point start;
+
+    /// Duration of the operation
+    loader_clock::duration duration{};
+
+    /// Thread that performed the operation
+    std::thread::id thread;
+};
+
+/*!
+ * \brief Observer that stores loader events into per thread lock-free buffers, so that they could be collected
+ * later by a single consumer via drain().
+ *
+ * Each thread that triggers loader events gets its own single producer single consumer ring buffer on the first
+ * event. Buffers of the exited threads are reused by the new threads along with the events that were not drained
+ * yet, so the memory is bounded by the peak count of the recording threads. Recording of the following events does not take locks and, after the buffer slots have been used once, does
+ * not allocate unless the names get longer. Events that do not fit into a full buffer are dropped and counted, see dropped().
+ *
+ * \b Example:
+ * \code
+ * midll::buffered_loader_observer observer;
+ * midll::set_loader_observer(&observer);
+ * // ...
+ * observer.drain([](const midll::loader_event_record& e) { metrics.record(e.kind, e.duration); });
+ * \endcode
+ */
+class buffered_loader_observer : public loader_observer
+{
+    struct ring
+    {
+        std::vector<loader_event_record> slots;
+        std::atomic<std::size_t> head{0}; // written by the consumer
+        std::atomic<std::size_t> tail{0}; // written by the producer
+        std::thread::id owner;
+
+        explicit ring(std::size_t capacity)
+            : slots(capacity)
+            , owner(std::this_thread::get_id())
+        {
+        }
+    };
+
+    // Shared with the threads, so that a thread that exits after the observer was destroyed does not touch it
+    struct rings_t
+    {
+        std::mutex mutex;                        // protects all the members
+        std::vector<std::unique_ptr<ring> > all; // rings are never removed, only reused
+        std::vector<ring*> free;                 // rings of the exited threads, capacity is enough for all the rings
+    };
+
+    // Rings owned by the thread, returned to the free lists of their observers when the thread exits
+    struct thread_rings
+    {
+        struct entry
+        {
+            std::uint64_t instance;
+            std::weak_ptr<rings_t> rings;
+            ring* r;
+        };
+
+        std::vector<entry> entries;
+        std::uint64_t last_instance = 0;
+        ring* last = nullptr;
+
+        ~thread_rings()
+        {
+            for (const entry& e : entries) {
+                if (const std::shared_ptr<rings_t> rings = e.rings.lock()) {
+                    std::lock_guard<std::mutex> lock(rings->mutex);
+                    e.r->owner = std::thread::id();
+                    rings->free.push_back(e.r);
+                }
+            }
+            exited() = true;
+        }
+    };
+
+    const std::size_t capacity_;
+    const std::uint64_t instance_;
+    const std::shared_ptr<rings_t> rings_;
+    std::mutex drain_mutex_; // keeps a single consumer per ring
+    std::atomic<std::uint64_t> dropped_{0};
+
+    static std::uint64_t next_instance() noexcept
+    {
+        static std::atomic<std::uint64_t> counter{0};
+        return ++counter;
+    }
+
+    static std::shared_ptr<rings_t> make_rings() noexcept
+    {
+        try {
+            return std::make_shared<rings_t>();
+        }
+        catch (...) {
+            // No memory: all the events are dropped
+            return nullptr;
+        }
+    }
+
+    // Trivially destructible flag is safe to read while the thread local objects of the thread are destroyed
+    static bool& exited() noexcept
+    {
+        thread_local bool flag = false;
+        return flag;
+    }
+
+    ring* this_thread_ring() noexcept
+    {
+        if (exited() || !rings_) {
+            return nullptr;
+        }
+
+        // Instance number protects from reusing a ring of a destroyed observer allocated at the same address
+        thread_local thread_rings cache;
+        if (cache.last_instance == instance_) {
+            return cache.last;
+        }
+
+        for (const thread_rings::entry& e : cache.entries) {
+            if (e.instance == instance_) {
+                cache.last_instance = instance_;
+                cache.last = e.r;
+                return cache.last;
+            }
+        }
+
+        try {
+            // Threads that record into many short lived observers keep only the rings of the alive ones
+            cache.entries.erase(std::remove_if(cache.entries.begin(), cache.entries.end(),
+                                               [](const thread_rings::entry& e) { return e.rings.expired(); }),
+                                cache.entries.end());
+            cache.entries.reserve(cache.entries.size() + 1);
+
+            std::lock_guard<std::mutex> lock(rings_->mutex);
+            ring* r = nullptr;
+            if (!rings_->free.empty()) {
+                r = rings_->free.back();
+                rings_->free.pop_back();
+                r->owner = std::this_thread::get_id();
+            }
+            else {
+                rings_->free.reserve(rings_->all.size() + 1);
+                rings_->all.push_back(std::unique_ptr<ring>(new ring(capacity_)));
+                r = rings_->all.back().get();
+            }
+
+            cache.entries.push_back(thread_rings::entry{instance_, rings_, r});
+            cache.last_instance = instance_;
+            cache.last = r;
+            return r;
+        }
+        catch (...) {
+            return nullptr;
+        }
+    }
+
+    template<class F>
+    void push(F fill) noexcept
+    {
+        ring* const r = this_thread_ring();
+        if (!r) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        const std::size_t tail = r->tail.load(std::memory_order_relaxed);
+        if (tail - r->head.load(std::memory_order_acquire) == r->slots.size()) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        loader_event_record& slot = r->slots[tail % r->slots.size()];
+        try {
+            fill(slot);
+        }
+        catch (...) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        slot.thread = r->owner;
+        r->tail.store(tail + 1, std::memory_order_release);
+    }
+
+public:
+    /*!
+     * \param capacity_per_thread Count of the events that each thread could store before they are drained.
+     * \throw Nothing.
+     */
+    explicit buffered_loader_observer(std::size_t capacity_per_thread = 1024) noexcept
+        : capacity_(capacity_per_thread ? capacity_per_thread : 1)
+        , instance_(next_instance())
+        , rings_(make_rings())
+    {
+    }
+
+    buffered_loader_observer(const buffered_loader_observer&) = delete;
+    buffered_loader_observer& operator=(const buffered_loader_observer&) = delete;
+
+    void on_load(const load_event& e) noexcept override
+    {
+        push([&e](loader_event_record& r) {
+            r.kind = loader_event_record::load;
+            const midll::fs::path& p = (e.resolved_path.empty() ? e.requested_path : e.resolved_path);
+            if constexpr (std::is_same_v<midll::fs::path::value_type, char>) {
+                r.name.assign(p.native());
+            }
+            else {
+                r.name.assign(p.string());
+            }
+            r.mode = e.mode;
+            r.ec = e.ec;
+            r.native_handle = e.native_handle;
+            r.start = e.start;
+            r.duration = e.duration;
+        });
+    }
+
+    void on_symbol(const symbol_event& e) noexcept override
+    {
+        push([&e](loader_event_record& r) {
+            r.kind = loader_event_record::symbol;
+            r.name.assign(e.name ? e.name : "");
+            r.mode = load_mode::default_mode;
+            r.ec = (e.found ? midll::fs::error_code() : midll::fs::make_error_code(midll::fs::errc::invalid_seek));
+            r.native_handle = e.native_handle;
+            r.start = e.start;
+            r.duration = e.duration;
+        });
+    }
+
+    void on_unload(const unload_event& e) noexcept override
+    {
+        push([&e](loader_event_record& r) {
+            r.kind = loader_event_record::unload;
+            r.name.clear();
+            r.mode = load_mode::default_mode;
+            r.ec.clear();
+            r.native_handle = e.native_handle;
+            r.start = e.start;
+            r.duration = e.duration;
+        });
+    }
+
+    /*!
+     * Passes all the stored events to `f` and removes them from the buffers. Events of each thread are passed in
+     * the order they were recorded. May be called concurrently with the event recording. `f` is called without
+     * holding the lock used for the event recording, so it may use midll, but must not call drain() itself.
+     *
+     * \param f Callable that accepts `const loader_event_record&`.
+     * \return Count of the passed events.
+     * \throw Whatever `f` throws. Events passed to `f` before the exception are removed.
+     */
+    template<class F>
+    std::size_t drain(F&& f)
+    {
+        std::lock_guard<std::mutex> drain_lock(drain_mutex_);
+
+        // Rings are never removed, so the pointers stay valid after the unlock
+        std::vector<ring*> rings;
+        if (rings_) {
+            std::lock_guard<std::mutex> lock(rings_->mutex);
+            rings.reserve(rings_->all.size());
+            for (const std::unique_ptr<ring>& r : rings_->all) {
+                rings.push_back(r.get());
+            }
+        }
+
+        std::size_t count = 0;
+        for (ring* r : rings) {
+            const std::size_t tail = r->tail.load(std::memory_order_acquire);
+            for (std::size_t head = r->head.load(std::memory_order_relaxed); head != tail; ++head) {
+                f(static_cast<const loader_event_record&>(r->slots[head % r->slots.size()]));
+                r->head.store(head + 1, std::memory_order_release);
+                ++count;
+            }
+        }
+        return count;
+    }
+
+    /// \return Count of the events that were dropped because of full buffers.
+    std::uint64_t dropped() const noexcept { return dropped_.load(std::memory_order_relaxed); }
+};
+
+} // namespace midll
@@ -0,0 +1,273 @@
+// Copyright Antony Polukhin, 2015-2024.
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <midll/config.hpp>
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+
+#if defined(MIDLL_OS_WINDOWS)
+#    include <windows.h>
+#else
+#    include <unistd.h>
+#    if defined(MIDLL_OS_LINUX) || defined(MIDLL_OS_ANDROID)
+#        include <sys/syscall.h>
+#    endif
+#endif
+
+#include <midll/detail/system_error.hpp>
+#include <midll/loader_observer.hpp>
+
+/// \file midll/chrome_trace_observer.hpp
+/// \brief Contains the midll::chrome_trace_observer class that writes the loader events in the Chrome trace event
+/// format.
+
+namespace midll
+{
+
+/*!
+ * \brief Observer that writes the loader events as Chrome trace event JSON, that could be opened in Perfetto
+ * (ui.perfetto.dev) or chrome://tracing.
+ *
+ * Each load, unload, symbol lookup and internal phase (see midll::phase_event) becomes a complete ("X") event on the
+ * thread that performed it, so the phases of a load are nested under the load. Events are written under a mutex as
+ * soon as they are received, so the observer is meant for startup and diagnostic traces rather than for always-on
+ * collection; see midll::buffered_loader_observer for the latter.
+ *
+ * \b Example:
+ * \code
+ * midll::chrome_trace_observer trace("startup_trace.json");
+ * midll::set_loader_observer(&trace);
+ * load_all_plugins();
+ * midll::set_loader_observer(nullptr);
+ * trace.close();
+ * \endcode
+ */
+class chrome_trace_observer : public loader_observer
+{
+    std::unique_ptr<std::ofstream> file_;
+    std::ostream* out_;
+    std::mutex mutex_;
+    bool first_ = true;
+    bool closed_ = false;
+    const loader_clock::time_point origin_;
+    const std::uint64_t pid_;
+
+    static std::uint64_t current_pid() noexcept
+    {
+#if defined(MIDLL_OS_WINDOWS)
+        return static_cast<std::uint64_t>(GetCurrentProcessId());
+#else
+        return static_cast<std::uint64_t>(::getpid());
+#endif
+    }
+
+    static std::uint64_t current_tid() noexcept
+    {
+#if defined(MIDLL_OS_WINDOWS)
+        return static_cast<std::uint64_t>(GetCurrentThreadId());
+#elif defined(MIDLL_OS_LINUX) || defined(MIDLL_OS_ANDROID)
+        thread_local const std::uint64_t tid = static_cast<std::uint64_t>(::syscall(SYS_gettid));
+        return tid;
+#else
+        // No portable numeric thread id, numbering the threads in the order of their first event
+        static std::atomic<std::uint64_t> counter{0};
+        thread_local const std::uint64_t tid = ++counter;
+        return tid;
+#endif
+    }
+
+    static void append_escaped(std::string& out, const char* s)
+    {
+        for (; *s; ++s) {
+            const unsigned char c = static_cast<unsigned char>(*s);
+            switch (c) {
+                case '"':
+                    out += "\\\"";
+                    break;
+                case '\\':
+                    out += "\\\\";
+                    break;
+                case '\n':
+                    out += "\\n";
+                    break;
+                case '\t':
+                    out += "\\t";
+                    break;
+                default:
+                    if (c < 0x20) {
+                        char buffer[8];
+                        std::snprintf(buffer, sizeof(buffer), "\\u%04x", c);
+                        out += buffer;
+                    }
+                    else {
+                        out += static_cast<char>(c);
+                    }
+            }
+        }
+    }
+
+    static void append_escaped(std::string& out, const midll::fs::path& p) { append_escaped(out, p.string().c_str()); }
+
+    static void append_us(std::string& out, loader_clock::duration d)
+    {
+        const long long ns = std::chrono::duration_cast<std::chrono::nanoseconds>(d).count();
+        // Sign is printed separately, otherwise values between -1 and 0 microseconds lose it
+        const unsigned long long magnitude =
+            (ns < 0 ? 0ull - static_cast<unsigned long long>(ns) : static_cast<unsigned long long>(ns));
+        char buffer[32];
+        std::snprintf(buffer, sizeof(buffer), "%s%llu.%03llu", (ns < 0 ? "-" : ""), magnitude / 1000, magnitude % 1000);
+        out += buffer;
+    }
+
+    // Appends the common part of an event, `args` must append the content of the "args" object.
+    template<class Name, class Args>
+    void write_event(const Name& name, const char* category, loader_clock::time_point start,
+                     loader_clock::duration duration, Args args) noexcept
+    {
+        try {
+            std::string event = "{\"name\":\"";
+            append_escaped(event, name);
+            event += "\",\"cat\":\"";
+            event += category;
+            event += "\",\"ph\":\"X\",\"ts\":";
+            append_us(event, start - origin_);
+            event += ",\"dur\":";
+            append_us(event, duration);
+            event += ",\"pid\":";
+            event += std::to_string(pid_);
+            event += ",\"tid\":";
+            event += std::to_string(current_tid());
+            event += ",\"args\":{";
+            args(event);
+            event += "}}";
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (closed_) {
+                return;
+            }
+            *out_ << (first_ ? "\n" : ",\n") << event;
+            first_ = false;
+        }
+        catch (...) {
+            // Tracing must not affect the traced operations, dropping the event
+        }
+    }
+
+    void open() { *out_ << '['; }
+
+public:
+    /*!
+     * Starts writing the trace into the stream. The stream must outlive the observer or the close() call.
+     *
+     * \param out Stream for the JSON.
+     * \throw Whatever the stream throws.
+     */
+    explicit chrome_trace_observer(std::ostream& out)
+        : out_(&out)
+        , origin_(loader_clock::now())
+        , pid_(current_pid())
+    {
+        open();
+    }
+
+    /*!
+     * Creates or truncates the file and starts writing the trace into it.
+     *
+     * \param trace_path Path of the JSON file.
+     * \throw std::bad_alloc in case of insufficient memory, \forcedlinkfs{system_error} if the file could not be
+     * opened.
+     */
+    explicit chrome_trace_observer(const midll::fs::path& trace_path)
+        : file_(new std::ofstream(trace_path, std::ios_base::out | std::ios_base::trunc))
+        , out_(file_.get())
+        , origin_(loader_clock::now())
+        , pid_(current_pid())
+    {
+        if (!*file_) {
+            const int err = errno;
+            throw midll::fs::system_error(
+                err ? midll::fs::error_code(err, std::generic_category())
+                    : midll::fs::make_error_code(midll::fs::errc::io_error),
+                "midll::chrome_trace_observer::chrome_trace_observer() failed to open " + trace_path.string());
+        }
+        open();
+    }
+
+    chrome_trace_observer(const chrome_trace_observer&) = delete;
+    chrome_trace_observer& operator=(const chrome_trace_observer&) = delete;
+
+    void on_load(const load_event& e) noexcept override
+    {
+        const midll::fs::path& p = (e.resolved_path.empty() ? e.requested_path : e.resolved_path);
+        write_event(p.filename(), "midll.load", e.start, e.duration, [&e, &p](std::string& args) {
+            args += "\"path\":\"";
+            append_escaped(args, p);
+            args += "\",\"mode\":" + std::to_string(static_cast<unsigned long long>(e.mode));
+            if (e.ec) {
+                args += ",\"error\":\"";
+                append_escaped(args, e.ec.message().c_str());
+                args += '"';
+            }
+        });
+    }
+
+    void on_symbol(const symbol_event& e) noexcept override
+    {
+        write_event(e.name ? e.name : "", "midll.symbol", e.start, e.duration, [&e](std::string& args) {
+            args += (e.found ? "\"found\":true" : "\"found\":false");
+        });
+    }
+
+    void on_unload(const unload_event& e) noexcept override
+    {
+        write_event("unload", "midll.unload", e.start, e.duration, [](std::string&) {});
+    }
+
+    void on_phase(const phase_event& e) noexcept override
+    {
+        write_event(e.name ? e.name : "", "midll.phase", e.start, e.duration, [&e](std::string& args) {
+            args += "\"subject\":\"";
+            append_escaped(args, e.subject);
+            args += '"';
+        });
+    }
+
+    /*!
+     * Finishes the JSON and flushes the stream. Events received after the call are ignored. Called by the destructor.
+     *
+     * \throw Nothing.
+     */
+    void close() noexcept
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (closed_) {
+            return;
+        }
+        closed_ = true;
+        try {
+            *out_ << "\n]\n";
+            out_->flush();
+        }
+        catch (...) {
+            // Stream reports the failure on its own, nothing to do in a noexcept function
+        }
+    }
+
+    ~chrome_trace_observer() { close(); }
+};
+
+} // namespace midll
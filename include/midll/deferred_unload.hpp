@@ -0,0 +1,57 @@
+// Copyright Antony Polukhin, 2015-2024.
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+#include <midll/config.hpp>
+#include <midll/detail/unload_reaper.hpp>
+
+/// \file midll/deferred_unload.hpp
+/// \brief Contains functions to control the background unloading of the libraries loaded with
+/// midll::load_mode::deferred_unload.
+
+namespace midll
+{
+
+/*!
+ * \brief Counters of the background thread that unloads the libraries loaded with load_mode::deferred_unload.
+ */
+struct deferred_unload_stats
+{
+    std::size_t queue_depth;                ///< Count of the libraries waiting to be unloaded
+    std::uint64_t reaped;                   ///< Count of the libraries unloaded by the background thread
+    std::chrono::nanoseconds total_latency; ///< Sum of the times between the unload request and the actual unload
+    std::chrono::nanoseconds max_latency;   ///< Maximal time between the unload request and the actual unload
+};
+
+/*!
+ * \return Current values of the counters of the background unloading.
+ * \throw Nothing.
+ */
+inline deferred_unload_stats deferred_unload_statistics() noexcept
+{
+    const midll::detail::unload_reaper& r = midll::detail::unload_reaper::instance();
+    return deferred_unload_stats{r.depth(), r.reaped(), std::chrono::nanoseconds(r.total_latency_ns()),
+                                 std::chrono::nanoseconds(r.max_latency_ns())};
+}
+
+/*!
+ * Blocks until all the libraries that were queued for the background unloading before the call are unloaded.
+ * Libraries queued by other threads during the call are not waited for, so the call returns even under a steady
+ * stream of unloads. Useful before checking that a library is gone, for example before replacing its file.
+ *
+ * \throw Nothing.
+ */
+inline void flush_deferred_unloads() noexcept
+{
+    midll::detail::unload_reaper::instance().flush();
+}
+
+} // namespace midll
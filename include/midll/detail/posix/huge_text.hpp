@@ -0,0 +1,94 @@
+// Copyright Antony Polukhin, 2015-2024.
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <midll/config.hpp>
+#include <midll/detail/posix/program_headers.hpp>
+
+#include <cstddef>
+
+#if defined(MIDLL_OS_LINUX)
+#    include <sys/mman.h>
+
+#    include <cstdint>
+#    include <cstring>
+#endif
+
+namespace midll
+{
+namespace detail
+{
+
+#if defined(MIDLL_OS_LINUX) && defined(MADV_HUGEPAGE)
+
+constexpr std::uintptr_t huge_page_size = 2 * 1024 * 1024;
+
+// Copies [begin, begin + size) into a huge page aligned anonymous mapping and atomically moves that mapping over
+// the original code with `mremap`. The original mapping stays intact if anything fails, so the code is never left
+// unmapped while other threads may execute it.
+inline std::size_t remap_to_huge_pages(std::uintptr_t begin, std::size_t size) noexcept
+{
+    const std::size_t reserve_size = size + huge_page_size;
+    void* const reserved = ::mmap(NULL, reserve_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (reserved == MAP_FAILED) {
+        return 0;
+    }
+
+    const std::uintptr_t reserved_begin = reinterpret_cast<std::uintptr_t>(reserved);
+    const std::uintptr_t aligned = (reserved_begin + huge_page_size - 1) & ~(huge_page_size - 1);
+    if (aligned != reserved_begin) {
+        ::munmap(reserved, aligned - reserved_begin);
+    }
+    if (reserved_begin + reserve_size != aligned + size) {
+        ::munmap(reinterpret_cast<void*>(aligned + size), reserved_begin + reserve_size - aligned - size);
+    }
+
+    void* const copy = reinterpret_cast<void*>(aligned);
+    ::madvise(copy, size, MADV_HUGEPAGE);
+    std::memcpy(copy, reinterpret_cast<const void*>(begin), size);
+
+    if (::mprotect(copy, size, PROT_READ | PROT_EXEC) != 0 ||
+        ::mremap(copy, size, size, MREMAP_MAYMOVE | MREMAP_FIXED, reinterpret_cast<void*>(begin)) == MAP_FAILED) {
+        ::munmap(copy, size);
+        return 0;
+    }
+
+    return size / huge_page_size;
+}
+
+// Remaps the 2 MiB aligned parts of the readable executable PT_LOAD segments onto huge pages.
+// Returns the count of the remapped huge pages.
+inline std::size_t remap_text_to_huge_pages(void* handle) noexcept
+{
+    std::size_t pages = 0;
+    midll::detail::for_each_program_header(handle, [&pages](const ElfW(Phdr) & phdr, ElfW(Addr) base) {
+        if (phdr.p_type != PT_LOAD || (phdr.p_flags & (PF_X | PF_R)) != (PF_X | PF_R)) {
+            return;
+        }
+
+        const std::uintptr_t segment_begin = static_cast<std::uintptr_t>(base + phdr.p_vaddr);
+        const std::uintptr_t begin = (segment_begin + huge_page_size - 1) & ~(huge_page_size - 1);
+        const std::uintptr_t end = (segment_begin + phdr.p_filesz) & ~(huge_page_size - 1);
+        if (begin < end) {
+            pages += midll::detail::remap_to_huge_pages(begin, end - begin);
+        }
+    });
+
+    return pages;
+}
+
+#else
+
+inline std::size_t remap_text_to_huge_pages(void* /*handle*/) noexcept
+{
+    return 0;
+}
+
+#endif
+
+} // namespace detail
+} // namespace midll
@@ -0,0 +1,169 @@
+// Copyright Antony Polukhin, 2015-2024.
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <midll/config.hpp>
+#include <midll/detail/posix/program_headers.hpp>
+
+#ifdef MIDLL_HAS_PROGRAM_HEADERS
+#    include <sys/mman.h>
+#    include <sys/resource.h>
+#    include <unistd.h>
+
+#    include <cerrno>
+#    include <cstdint>
+#    include <mutex>
+#    include <new>
+#    include <unordered_map>
+#endif
+
+namespace midll
+{
+namespace detail
+{
+
+#ifdef MIDLL_HAS_PROGRAM_HEADERS
+
+// Calls `f(void* begin, std::size_t size)` for each page aligned PT_LOAD segment of the object.
+template<class F>
+bool for_each_mapped_segment(void* handle, F f)
+{
+    const std::uintptr_t page_size = static_cast<std::uintptr_t>(::sysconf(_SC_PAGESIZE));
+    return midll::detail::for_each_program_header(handle, [&](const ElfW(Phdr) & phdr, ElfW(Addr) base) {
+        if (phdr.p_type != PT_LOAD || !phdr.p_memsz) {
+            return;
+        }
+
+        const std::uintptr_t begin = static_cast<std::uintptr_t>(base + phdr.p_vaddr) & ~(page_size - 1);
+        const std::uintptr_t end =
+            (static_cast<std::uintptr_t>(base + phdr.p_vaddr + phdr.p_memsz) + page_size - 1) & ~(page_size - 1);
+        f(reinterpret_cast<void*>(begin), static_cast<std::size_t>(end - begin));
+    });
+}
+
+// Faults in the pages of the readable segments of the object. Pages are only read, so the file backed pages stay
+// shared with the other processes.
+inline void prefault_segments(void* handle) noexcept
+{
+    const std::uintptr_t page_size = static_cast<std::uintptr_t>(::sysconf(_SC_PAGESIZE));
+    midll::detail::for_each_program_header(handle, [page_size](const ElfW(Phdr) & phdr, ElfW(Addr) base) {
+        if (phdr.p_type != PT_LOAD || !phdr.p_memsz || !(phdr.p_flags & PF_R)) {
+            return;
+        }
+
+        const std::uintptr_t begin = static_cast<std::uintptr_t>(base + phdr.p_vaddr) & ~(page_size - 1);
+        const std::uintptr_t end = static_cast<std::uintptr_t>(base + phdr.p_vaddr + phdr.p_memsz);
+#    ifdef MADV_POPULATE_READ
+        // Single call instead of a page fault per page, fails with EINVAL on kernels older than 5.14
+        const std::uintptr_t aligned_end = (end + page_size - 1) & ~(page_size - 1);
+        if (::madvise(reinterpret_cast<void*>(begin), aligned_end - begin, MADV_POPULATE_READ) == 0) {
+            return;
+        }
+#    endif
+        for (std::uintptr_t page = begin; page < end; page += page_size) {
+            (void)*reinterpret_cast<const volatile char*>(page);
+        }
+    });
+}
+
+// `mlock` does not nest, so the locks are counted per loaded object and the segments are unlocked by the last
+// unlock. Handles of the same object are equal, so they are used as the keys.
+struct memory_locks_t
+{
+    std::mutex mutex;
+    std::unordered_map<void*, std::size_t> counts;
+};
+
+inline memory_locks_t& memory_locks() noexcept
+{
+    static memory_locks_t locks;
+    return locks;
+}
+
+inline void munlock_segments(void* handle) noexcept
+{
+    midll::detail::for_each_mapped_segment(handle, [](void* begin, std::size_t size) { ::munlock(begin, size); });
+}
+
+inline void unlock_segments(void* handle) noexcept
+{
+    memory_locks_t& locks = midll::detail::memory_locks();
+    std::lock_guard<std::mutex> guard(locks.mutex);
+    const auto it = locks.counts.find(handle);
+    if (it == locks.counts.end() || --it->second) {
+        return;
+    }
+
+    locks.counts.erase(it);
+    midll::detail::munlock_segments(handle);
+}
+
+// Locks all the segments of the object or none of them.
+inline void lock_segments(void* handle, midll::fs::error_code& ec) noexcept
+{
+    memory_locks_t& locks = midll::detail::memory_locks();
+    std::lock_guard<std::mutex> guard(locks.mutex);
+    std::size_t* count = nullptr;
+    try {
+        count = &locks.counts[handle];
+    }
+    catch (const std::bad_alloc&) {
+        ec = midll::fs::make_error_code(midll::fs::errc::not_enough_memory);
+        return;
+    }
+
+    if (*count) {
+        ++*count;
+        return;
+    }
+
+    int error = 0;
+    const bool found = midll::detail::for_each_mapped_segment(handle, [&error](void* begin, std::size_t size) {
+        if (!error && ::mlock(begin, size) != 0) {
+            error = errno;
+        }
+    });
+
+    if (found && !error) {
+        *count = 1;
+        return;
+    }
+
+    locks.counts.erase(handle);
+    if (!found) {
+        ec = midll::fs::make_error_code(midll::fs::errc::bad_file_descriptor);
+        return;
+    }
+
+    midll::detail::munlock_segments(handle);
+
+    struct rlimit limit;
+    if ((error == ENOMEM || error == EPERM) && ::getrlimit(RLIMIT_MEMLOCK, &limit) == 0 &&
+        limit.rlim_cur != RLIM_INFINITY) {
+        // RLIMIT_MEMLOCK is too small to fit the library along with the memory that is already locked
+        ec = midll::fs::make_error_code(midll::fs::errc::not_enough_memory);
+        return;
+    }
+
+    ec = midll::fs::error_code(error, midll::fs::system_category());
+}
+
+#else
+
+inline void prefault_segments(void* /*handle*/) noexcept {}
+
+inline void unlock_segments(void* /*handle*/) noexcept {}
+
+inline void lock_segments(void* /*handle*/, midll::fs::error_code& ec) noexcept
+{
+    ec = midll::fs::make_error_code(midll::fs::errc::operation_not_supported);
+}
+
+#endif
+
+} // namespace detail
+} // namespace midll
@@ -160,7 +160,7 @@ inline midll::fs::path path_from_handle(void *handle, midll::fs::error_code &ec)
         return program_location_impl(ec);
     }
 
-    return midll::fs::path(link_map->l_name);
+    return midll::detail::module_path_from_name(link_map->l_name);
 }
 
 } // namespace detail
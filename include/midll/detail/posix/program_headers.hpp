@@ -0,0 +1,163 @@
+// Copyright Antony Polukhin, 2015-2024.
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <midll/config.hpp>
+
+#if defined(MIDLL_OS_LINUX) || defined(MIDLL_OS_FREEBSD)
+#    define MIDLL_HAS_PROGRAM_HEADERS
+
+#    include <dlfcn.h>
+#    include <link.h> // dl_iterate_phdr, struct link_map, ElfW
+
+#    include <cstring>
+#    include <string>
+
+namespace midll
+{
+namespace detail
+{
+
+inline const struct link_map* link_map_from_handle(void* handle) noexcept
+{
+    if (!handle) {
+        return nullptr;
+    }
+
+    const struct link_map* link_map = nullptr;
+#    ifdef MIDLL_OS_FREEBSD
+    // See the comments in path_from_handle(): FreeBSD handles are not `struct link_map*`.
+    if (dlinfo(handle, RTLD_DI_LINKMAP, &link_map) < 0) {
+        link_map = nullptr;
+    }
+#    else
+    link_map = static_cast<const struct link_map*>(handle);
+#    endif
+    return link_map;
+}
+
+struct program_headers_t
+{
+    const ElfW(Phdr) * phdr;
+    ElfW(Half) phnum;
+    ElfW(Addr) base;
+};
+
+/// Finds the program headers of the object referenced by `handle`. Returns false if the object was not found among
+/// the loaded ones. Program headers are mapped along with the object, so they stay valid while `handle` is loaded.
+inline bool find_program_headers(void* handle, program_headers_t& headers) noexcept
+{
+    const struct link_map* const link_map = midll::detail::link_map_from_handle(handle);
+    if (!link_map) {
+        return false;
+    }
+
+    struct context_t
+    {
+        const struct link_map* link_map;
+        program_headers_t* headers;
+        bool found;
+    } context = {link_map, &headers, false};
+
+    // `struct link_map` has no program headers, so we look for the object with the same load address and name.
+    // Objects loaded into different namespaces via `dlmopen` share the name but never the address.
+    dl_iterate_phdr(
+        [](struct dl_phdr_info* info, std::size_t, void* data) -> int {
+            context_t& ctx = *static_cast<context_t*>(data);
+            const char* const name = ctx.link_map->l_name ? ctx.link_map->l_name : "";
+            const char* const info_name = info->dlpi_name ? info->dlpi_name : "";
+            if (info->dlpi_addr != ctx.link_map->l_addr || std::strcmp(name, info_name) != 0) {
+                return 0;
+            }
+
+            *ctx.headers = program_headers_t{info->dlpi_phdr, info->dlpi_phnum, info->dlpi_addr};
+            ctx.found = true;
+            return 1;
+        },
+        &context);
+
+    return context.found;
+}
+
+/// Calls `f(const ElfW(Phdr)& phdr, ElfW(Addr) base)` for each program header of the object referenced by `handle`.
+/// Returns false if the object was not found among the loaded ones.
+///
+/// `f` is called after `dl_iterate_phdr` returns, so it may throw, allocate or fault in pages without holding
+/// the loader lock.
+template<class F>
+bool for_each_program_header(void* handle, F f)
+{
+    program_headers_t headers;
+    if (!midll::detail::find_program_headers(handle, headers)) {
+        return false;
+    }
+
+    for (ElfW(Half) i = 0; i < headers.phnum; ++i) {
+        f(headers.phdr[i], headers.base);
+    }
+    return true;
+}
+
+// Returns the name under which the object referenced by `sl` was loaded or an empty string if no such object
+// is loaded. Compares paths lexically and does not touch the filesystem. Paths without parent path are matched
+// against the file names of the loaded objects, just like `dlopen` does.
+inline std::string loaded_object_name(const midll::fs::path& sl)
+{
+    struct context_t
+    {
+        midll::fs::path wanted;
+        bool by_filename;
+        midll::fs::path cwd;
+        std::string result;
+
+        midll::fs::path absolute(const midll::fs::path& p)
+        {
+            if (p.is_absolute()) {
+                return p.lexically_normal();
+            }
+
+            if (cwd.empty()) {
+                midll::fs::error_code ignore;
+                cwd = midll::fs::current_path(ignore);
+            }
+            return (cwd / p).lexically_normal();
+        }
+    } context;
+
+    context.by_filename = !sl.has_parent_path();
+    context.wanted = (context.by_filename ? sl.filename() : context.absolute(sl));
+
+    dl_iterate_phdr(
+        [](struct dl_phdr_info* info, std::size_t, void* data) -> int {
+            context_t& ctx = *static_cast<context_t*>(data);
+            if (!info->dlpi_name || *info->dlpi_name == '\0') {
+                return 0;
+            }
+
+            // Exceptions must not propagate through the `dl_iterate_phdr` that holds the loader lock
+            try {
+                const midll::fs::path name(info->dlpi_name);
+                if ((ctx.by_filename ? name.filename() : ctx.absolute(name)) != ctx.wanted) {
+                    return 0;
+                }
+
+                ctx.result = info->dlpi_name;
+            }
+            catch (...) {
+                ctx.result.clear();
+            }
+            return 1;
+        },
+        &context);
+
+    return context.result;
+}
+
+} // namespace detail
+} // namespace midll
+
+#endif
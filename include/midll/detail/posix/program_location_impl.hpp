@@ -10,6 +10,9 @@
 #include <midll/config.hpp>
 #include <midll/detail/system_error.hpp>
 
+#include <sys/stat.h>
+#include <sys/types.h>
+
 #if defined(MIDLL_OS_MACOS) || defined(MIDLL_OS_IOS)
 
 #    include <mach-o/dyld.h>
@@ -18,7 +21,7 @@ namespace midll
 {
 namespace detail
 {
-inline midll::fs::path program_location_impl(midll::fs::error_code &ec)
+inline midll::fs::path read_program_location(midll::fs::error_code &ec)
 {
     ec.clear();
 
@@ -48,7 +51,7 @@ namespace midll
 {
 namespace detail
 {
-inline midll::fs::path program_location_impl(midll::fs::error_code& ec)
+inline midll::fs::path read_program_location(midll::fs::error_code& ec)
 {
     ec.clear();
 
@@ -74,7 +77,7 @@ namespace midll
 {
 namespace detail
 {
-inline midll::fs::path program_location_impl(midll::fs::error_code &ec)
+inline midll::fs::path read_program_location(midll::fs::error_code &ec)
 {
     ec.clear();
 
@@ -97,7 +100,7 @@ namespace midll
 {
 namespace detail
 {
-inline midll::fs::path program_location_impl(midll::fs::error_code &ec)
+inline midll::fs::path read_program_location(midll::fs::error_code &ec)
 {
     // We can not use
     // midll::detail::path_from_handle(dlopen(NULL, RTLD_LAZY | RTLD_LOCAL), ignore);
@@ -109,3 +112,78 @@ inline midll::fs::path program_location_impl(midll::fs::error_code &ec)
 } // namespace midll
 
 #endif
+
+namespace midll
+{
+namespace detail
+{
+
+// Location and file identity of the running program do not change, so they are computed once per process.
+struct program_identity
+{
+    midll::fs::path location;
+    midll::fs::error_code ec;
+    bool has_file_id;
+    dev_t device;
+    ino_t inode;
+
+    static const program_identity& get()
+    {
+        static const program_identity identity;
+        return identity;
+    }
+
+private:
+    program_identity()
+        : location(midll::detail::read_program_location(ec))
+        , has_file_id(false)
+        , device()
+        , inode()
+    {
+        struct stat st;
+        if (!ec && ::stat(location.c_str(), &st) == 0) {
+            has_file_id = true;
+            device = st.st_dev;
+            inode = st.st_ino;
+        }
+    }
+};
+
+inline midll::fs::path program_location_impl(midll::fs::error_code& ec)
+{
+    const program_identity& identity = program_identity::get();
+    ec = identity.ec;
+    return identity.location;
+}
+
+// Returns true if `p` refers to the running program, including symlinks and hardlinks to it under another name.
+// Costs a single `stat` call.
+inline bool is_program_location(const midll::fs::path& p)
+{
+    const program_identity& identity = program_identity::get();
+    if (!identity.has_file_id) {
+        return false;
+    }
+
+    struct stat st;
+    return ::stat(p.c_str(), &st) == 0 && st.st_dev == identity.device && st.st_ino == identity.inode;
+}
+
+// Returns the name of a loaded module as a full path. Modules that were loaded by a relative path (for example
+// "./libfoo.so") keep that name in the loader, it is resolved against the current directory.
+inline midll::fs::path module_path_from_name(const char* name)
+{
+    midll::fs::path p(name);
+    if (p.is_relative()) {
+        midll::fs::error_code ec;
+        midll::fs::path absolute = midll::fs::absolute(p, ec);
+        if (!ec) {
+            return absolute.lexically_normal();
+        }
+    }
+
+    return p;
+}
+
+} // namespace detail
+} // namespace midll
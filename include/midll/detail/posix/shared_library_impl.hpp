@@ -8,8 +8,13 @@
 #pragma once
 
 #include <midll/config.hpp>
+#include <midll/detail/posix/huge_text.hpp>
+#include <midll/detail/posix/memory_lock.hpp>
 #include <midll/detail/posix/path_from_handle.hpp>
 #include <midll/detail/posix/program_location_impl.hpp>
+#include <midll/detail/unload_reaper.hpp>
+#include <midll/link_namespace.hpp>
+#include <midll/loader_observer.hpp>
 #include <midll/shared_library_load_mode.hpp>
 
 #include <dlfcn.h>
@@ -21,6 +26,10 @@
 #    include <sys/link.h>
 #endif
 
+#ifdef LM_ID_NEWLM
+#    define MIDLL_HAS_DLMOPEN
+#endif
+
 namespace midll
 {
 namespace detail
@@ -33,6 +42,9 @@ public:
 
     shared_library_impl() noexcept
         : handle_(NULL)
+        , huge_pages_(0)
+        , locked_(false)
+        , deferred_unload_(false)
     {
     }
 
@@ -43,8 +55,14 @@ public:
 
     shared_library_impl(shared_library_impl&& sl) noexcept
         : handle_(sl.handle_)
+        , huge_pages_(sl.huge_pages_)
+        , locked_(sl.locked_)
+        , deferred_unload_(sl.deferred_unload_)
     {
         sl.handle_ = NULL;
+        sl.huge_pages_ = 0;
+        sl.locked_ = false;
+        sl.deferred_unload_ = false;
     }
 
     shared_library_impl& operator=(shared_library_impl&& sl) noexcept
@@ -64,91 +82,66 @@ public:
         return actual_path;
     }
 
-    void load(midll::fs::path sl, load_mode::type portable_mode, midll::fs::error_code& ec)
+    void load(const midll::fs::path& sl, load_mode::type portable_mode, midll::fs::error_code& ec,
+              link_namespace ns = link_namespace::base())
     {
-        using native_mode_t = int;
-        native_mode_t native_mode = static_cast<native_mode_t>(portable_mode);
         unload();
-
-        // Do not allow opening NULL paths. User must use program_location() instead
-        if (sl.empty()) {
-            midll::detail::reset_dlerror();
-            ec = midll::fs::make_error_code(midll::fs::errc::bad_file_descriptor);
-
+#ifndef MIDLL_HAS_DLMOPEN
+        if (ns != link_namespace::base()) {
+            ec = midll::fs::make_error_code(midll::fs::errc::operation_not_supported);
             return;
         }
-
-        // Fixing modes
-        if (!(native_mode & load_mode::rtld_now)) {
-            native_mode |= load_mode::rtld_lazy;
+#endif
+        const load_mode::type post_load_modes =
+            load_mode::huge_text | load_mode::mlock | load_mode::prefault | load_mode::deferred_unload;
+        load_impl(sl, portable_mode & ~post_load_modes, ns, ec);
+        if (!handle_) {
+            return;
         }
 
-        if (!(native_mode & load_mode::rtld_global)) {
-            native_mode |= load_mode::rtld_local;
-        }
+        deferred_unload_ = !!(portable_mode & load_mode::deferred_unload);
 
-#if defined(MIDLL_OS_LINUX) || defined(MIDLL_OS_ANDROID)
-        if (!sl.has_parent_path() && !(native_mode & load_mode::search_system_folders)) {
-            sl = "." / sl;
+        if (!!(portable_mode & load_mode::huge_text)) {
+            midll::detail::observed_phase phase("huge_text", sl);
+            huge_pages_ = midll::detail::remap_text_to_huge_pages(handle_);
         }
-#else
-        if (!sl.is_absolute() && !(native_mode & load_mode::search_system_folders)) {
-            midll::fs::error_code current_path_ec;
-            midll::fs::path prog_loc = midll::fs::current_path(current_path_ec);
-            if (!current_path_ec) {
-                prog_loc /= sl;
-                sl.swap(prog_loc);
-            }
-        }
-#endif
-
-        native_mode = static_cast<unsigned>(native_mode) & ~static_cast<unsigned>(load_mode::search_system_folders);
 
-        // Trying to open with appended decorations
-        if (!!(native_mode & load_mode::append_decorations)) {
-            native_mode = static_cast<unsigned>(native_mode) & ~static_cast<unsigned>(load_mode::append_decorations);
+#ifdef MIDLL_HAS_PROGRAM_HEADERS
+        if (!!(portable_mode & load_mode::prefault)) {
+            midll::detail::observed_phase phase("prefault", sl);
+            midll::detail::prefault_segments(handle_);
+        }
 
-            midll::fs::path actual_path = decorate(sl);
-            handle_ = dlopen(actual_path.c_str(), native_mode);
-            if (handle_) {
-                midll::detail::reset_dlerror();
-                return;
+        if (!!(portable_mode & load_mode::mlock)) {
+            {
+                midll::detail::observed_phase phase("mlock", sl);
+                lock_in_memory(ec);
             }
-            midll::fs::error_code prog_loc_err;
-            midll::fs::path loc = midll::detail::program_location_impl(prog_loc_err);
-            if (midll::fs::exists(actual_path) && !midll::fs::equivalent(sl, loc, prog_loc_err)) {
-                // decorated path exists : current error is not a bad file descriptor and we are not trying to load the
-                // executable itself
-                ec = midll::fs::make_error_code(midll::fs::errc::executable_format_error);
-                return;
+            if (ec) {
+                unload();
             }
         }
+#endif
+    }
 
-        // Opening by exactly specified path
-        handle_ = dlopen(sl.c_str(), native_mode);
-        if (handle_) {
-            midll::detail::reset_dlerror();
-            return;
-        }
+    void find_loaded(const midll::fs::path& sl, midll::fs::error_code& ec)
+    {
+        unload();
 
-        ec = midll::fs::make_error_code(midll::fs::errc::bad_file_descriptor);
+        // RTLD_NOLOAD never maps a new object, but for paths that differ from the name of a loaded object
+        // `dlopen` still opens and stats the file. So we look for the exact name first and pass it to `dlopen`.
+#ifdef MIDLL_HAS_PROGRAM_HEADERS
+        const std::string name = midll::detail::loaded_object_name(sl);
+        if (!name.empty()) {
+            handle_ = dlopen(name.c_str(), RTLD_NOLOAD | RTLD_LAZY);
+        }
+#else
+        handle_ = dlopen(sl.c_str(), RTLD_NOLOAD | RTLD_LAZY);
+#endif
 
-        // Maybe user wanted to load the executable itself? Checking...
-        // We assume that usually user wants to load a dynamic library not the executable itself, that's why
-        // we try this only after traditional load fails.
-        midll::fs::error_code prog_loc_err;
-        midll::fs::path loc = midll::detail::program_location_impl(prog_loc_err);
-        if (!prog_loc_err && midll::fs::equivalent(sl, loc, prog_loc_err) && !prog_loc_err) {
-            // As is known the function dlopen() loads the dynamic library file
-            // named by the null-terminated string filename and returns an opaque
-            // "handle" for the dynamic library. If filename is NULL, then the
-            // returned handle is for the main program.
-            ec.clear();
+        if (!handle_) {
             midll::detail::reset_dlerror();
-            handle_ = dlopen(NULL, native_mode);
-            if (!handle_) {
-                ec = midll::fs::make_error_code(midll::fs::errc::bad_file_descriptor);
-            }
+            ec = midll::fs::make_error_code(midll::fs::errc::bad_file_descriptor);
         }
     }
 
@@ -160,11 +153,62 @@ public:
             return;
         }
 
-        dlclose(handle_);
+        unlock_in_memory();
+        if (deferred_unload_) {
+            midll::detail::unload_reaper::enqueue(handle_, [](void* h) noexcept { dlclose(h); });
+        }
+        else {
+            dlclose(handle_);
+        }
         handle_ = 0;
+        huge_pages_ = 0;
+        deferred_unload_ = false;
+    }
+
+    void swap(shared_library_impl& rhs) noexcept
+    {
+        std::swap(handle_, rhs.handle_);
+        std::swap(huge_pages_, rhs.huge_pages_);
+        std::swap(locked_, rhs.locked_);
+        std::swap(deferred_unload_, rhs.deferred_unload_);
+    }
+
+    bool is_unload_deferred() const noexcept { return deferred_unload_; }
+    void defer_unload(bool deferred) noexcept { deferred_unload_ = (deferred && is_loaded()); }
+
+    std::size_t huge_text_pages() const noexcept { return huge_pages_; }
+
+    void lock_in_memory(midll::fs::error_code& ec) noexcept
+    {
+        if (locked_) {
+            return;
+        }
+
+        midll::detail::lock_segments(handle_, ec);
+        locked_ = !ec;
+    }
+
+    void unlock_in_memory() noexcept
+    {
+        if (locked_) {
+            midll::detail::unlock_segments(handle_);
+            locked_ = false;
+        }
     }
 
-    void swap(shared_library_impl& rhs) noexcept { std::swap(handle_, rhs.handle_); }
+    bool is_locked_in_memory() const noexcept { return locked_; }
+
+    link_namespace namespace_id() const noexcept
+    {
+#ifdef MIDLL_HAS_DLMOPEN
+        Lmid_t id = LM_ID_BASE;
+        if (handle_ && dlinfo(handle_, RTLD_DI_LMID, &id) == 0) {
+            return link_namespace(static_cast<long>(id));
+        }
+        midll::detail::reset_dlerror();
+#endif
+        return link_namespace::base();
+    }
 
     midll::fs::path full_module_path(midll::fs::error_code& ec) const
     {
@@ -200,7 +244,127 @@ public:
     native_handle_t native() const noexcept { return handle_; }
 
 private:
+    static native_handle_t open(const midll::fs::path& path, int native_mode, link_namespace ns) noexcept
+    {
+        midll::detail::observed_phase phase("open", path);
+#ifdef MIDLL_HAS_DLMOPEN
+        if (ns != link_namespace::base()) {
+            return dlmopen(static_cast<Lmid_t>(ns.id()), path.c_str(), native_mode);
+        }
+#else
+        (void)ns;
+#endif
+        return dlopen(path.c_str(), native_mode);
+    }
+
+    void load_impl(midll::fs::path sl, load_mode::type portable_mode, link_namespace ns, midll::fs::error_code& ec)
+    {
+        using native_mode_t = int;
+        native_mode_t native_mode = static_cast<native_mode_t>(portable_mode);
+
+        // Do not allow opening NULL paths. User must use program_location() instead
+        if (sl.empty()) {
+            midll::detail::reset_dlerror();
+            ec = midll::fs::make_error_code(midll::fs::errc::bad_file_descriptor);
+
+            return;
+        }
+
+        // Fixing modes
+        if (!(native_mode & load_mode::rtld_now)) {
+            native_mode |= load_mode::rtld_lazy;
+        }
+
+        if (!(native_mode & load_mode::rtld_global)) {
+            native_mode |= load_mode::rtld_local;
+        }
+
+        // Misses of bare names are not classified via the filesystem, so probing a list of optional plugins by name
+        // costs only the `dlopen` calls. Bare names that match the file name of the program are still checked.
+        const bool classify_miss =
+            (sl.has_parent_path() || sl.filename() == midll::detail::program_identity::get().location.filename());
+
+        {
+            midll::detail::observed_phase phase("resolve_path", sl);
+#if defined(MIDLL_OS_LINUX) || defined(MIDLL_OS_ANDROID)
+            if (!sl.has_parent_path() && !(native_mode & load_mode::search_system_folders)) {
+                sl = "." / sl;
+            }
+#else
+            if (!sl.is_absolute() && !(native_mode & load_mode::search_system_folders)) {
+                midll::fs::error_code current_path_ec;
+                midll::fs::path prog_loc = midll::fs::current_path(current_path_ec);
+                if (!current_path_ec) {
+                    prog_loc /= sl;
+                    sl.swap(prog_loc);
+                }
+            }
+#endif
+        }
+
+        native_mode = static_cast<unsigned>(native_mode) & ~static_cast<unsigned>(load_mode::search_system_folders);
+
+        // Trying to open with appended decorations
+        midll::fs::path decorated_path;
+        if (!!(native_mode & load_mode::append_decorations)) {
+            native_mode = static_cast<unsigned>(native_mode) & ~static_cast<unsigned>(load_mode::append_decorations);
+
+            decorated_path = decorate(sl);
+            handle_ = open(decorated_path, native_mode, ns);
+            if (handle_) {
+                midll::detail::reset_dlerror();
+                return;
+            }
+        }
+
+        // Opening by exactly specified path
+        handle_ = open(sl, native_mode, ns);
+        if (handle_) {
+            midll::detail::reset_dlerror();
+            return;
+        }
+
+        ec = midll::fs::make_error_code(midll::fs::errc::bad_file_descriptor);
+        if (!classify_miss) {
+            return;
+        }
+
+        // Both loads failed, only now the filesystem is checked to classify the error
+        midll::fs::error_code exists_err;
+        if (!decorated_path.empty() && midll::fs::exists(decorated_path, exists_err) &&
+            !midll::detail::is_program_location(sl)) {
+            // decorated path exists : current error is not a bad file descriptor and we are not trying to load the
+            // executable itself
+            ec = midll::fs::make_error_code(midll::fs::errc::executable_format_error);
+            return;
+        }
+
+        // Maybe user wanted to load the executable itself? Checking...
+        // We assume that usually user wants to load a dynamic library not the executable itself, that's why
+        // we try this only after traditional load fails. The executable could not be loaded into other namespaces.
+        if (ns != link_namespace::base()) {
+            return;
+        }
+
+        // The check costs a single `stat`, it is done only after `dlopen` has failed
+        if (midll::detail::is_program_location(sl)) {
+            // As is known the function dlopen() loads the dynamic library file
+            // named by the null-terminated string filename and returns an opaque
+            // "handle" for the dynamic library. If filename is NULL, then the
+            // returned handle is for the main program.
+            ec.clear();
+            midll::detail::reset_dlerror();
+            handle_ = dlopen(NULL, native_mode);
+            if (!handle_) {
+                ec = midll::fs::make_error_code(midll::fs::errc::bad_file_descriptor);
+            }
+        }
+    }
+
     native_handle_t handle_;
+    std::size_t huge_pages_;
+    bool locked_;
+    bool deferred_unload_;
 };
 
 } // namespace detail
@@ -0,0 +1,181 @@
+// Copyright Antony Polukhin, 2015-2024.
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <midll/config.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace midll
+{
+namespace detail
+{
+
+// Background thread that closes native library handles for the libraries loaded with `load_mode::deferred_unload`.
+class unload_reaper
+{
+public:
+    using close_function_t = void (*)(void*) noexcept;
+
+private:
+    using clock = std::chrono::steady_clock;
+
+    struct entry
+    {
+        void* handle;
+        close_function_t close;
+        clock::time_point enqueued;
+    };
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable idle_;
+    std::vector<entry> queue_;
+    std::uint64_t enqueued_ = 0; // sequence number of the last enqueued handle
+    std::uint64_t closed_ = 0;   // sequence number of the last closed handle, handles are closed in order
+    bool stop_ = false;
+    bool running_ = false;
+    std::thread thread_;
+
+    std::atomic<std::size_t> depth_{0};
+    std::atomic<std::uint64_t> reaped_{0};
+    std::atomic<std::uint64_t> total_latency_ns_{0};
+    std::atomic<std::uint64_t> max_latency_ns_{0};
+
+    // Libraries could be unloaded from destructors of static objects after the reaper was destroyed. Trivially
+    // destructible flag is safe to read at any point of the program termination.
+    static std::atomic<bool>& destroyed() noexcept
+    {
+        static std::atomic<bool> flag{false};
+        return flag;
+    }
+
+    unload_reaper() noexcept = default;
+
+    void run() noexcept
+    {
+        std::vector<entry> batch;
+        std::unique_lock<std::mutex> lock(mutex_);
+        for (;;) {
+            // Thread exits after a second without work and is restarted by the next enqueue()
+            const bool has_work =
+                wake_.wait_for(lock, std::chrono::seconds(1), [this]() { return stop_ || !queue_.empty(); });
+            if (!has_work || queue_.empty()) {
+                running_ = false;
+                return;
+            }
+
+            batch.swap(queue_);
+            lock.unlock();
+
+            for (const entry& e : batch) {
+                e.close(e.handle);
+
+                const std::uint64_t latency = static_cast<std::uint64_t>(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - e.enqueued).count());
+                total_latency_ns_.fetch_add(latency, std::memory_order_relaxed);
+                std::uint64_t max = max_latency_ns_.load(std::memory_order_relaxed);
+                while (max < latency && !max_latency_ns_.compare_exchange_weak(max, latency)) {
+                }
+                reaped_.fetch_add(1, std::memory_order_relaxed);
+                depth_.fetch_sub(1, std::memory_order_relaxed);
+            }
+            const std::uint64_t closed = batch.size();
+            batch.clear();
+
+            lock.lock();
+            closed_ += closed;
+            idle_.notify_all();
+        }
+    }
+
+public:
+    static unload_reaper& instance() noexcept
+    {
+        static unload_reaper reaper;
+        return reaper;
+    }
+
+    unload_reaper(const unload_reaper&) = delete;
+    unload_reaper& operator=(const unload_reaper&) = delete;
+
+    ~unload_reaper()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        wake_.notify_one();
+        if (thread_.joinable()) {
+            thread_.join();
+        }
+        destroyed().store(true);
+    }
+
+    // Closes the handle synchronously if the reaper is not available.
+    static void enqueue(void* handle, close_function_t close) noexcept
+    {
+        if (destroyed().load()) {
+            close(handle);
+            return;
+        }
+
+        unload_reaper& r = instance();
+        bool enqueued = false;
+        try {
+            std::lock_guard<std::mutex> lock(r.mutex_);
+            if (!r.stop_) {
+                if (!r.running_) {
+                    if (r.thread_.joinable()) {
+                        r.thread_.join(); // thread has already released the lock and is exiting
+                    }
+                    r.thread_ = std::thread([&r]() { r.run(); });
+                    r.running_ = true;
+                }
+                r.queue_.push_back(entry{handle, close, clock::now()});
+                ++r.enqueued_;
+                r.depth_.fetch_add(1, std::memory_order_relaxed);
+                enqueued = true;
+            }
+        }
+        catch (...) {
+            // No memory or no threads: falling back to the synchronous unload
+        }
+
+        if (enqueued) {
+            r.wake_.notify_one();
+        }
+        else {
+            close(handle);
+        }
+    }
+
+    // Waits until all the handles enqueued before the call are closed. Handles enqueued during the wait are not
+    // waited for, so the call returns even if other threads keep unloading libraries.
+    void flush() noexcept
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        const std::uint64_t last = enqueued_;
+        const auto is_passed = [this, last]() { return closed_ >= last; };
+        while (!idle_.wait_for(lock, std::chrono::milliseconds(100), is_passed)) {
+        }
+    }
+
+    std::size_t depth() const noexcept { return depth_.load(std::memory_order_relaxed); }
+    std::uint64_t reaped() const noexcept { return reaped_.load(std::memory_order_relaxed); }
+    std::uint64_t total_latency_ns() const noexcept { return total_latency_ns_.load(std::memory_order_relaxed); }
+    std::uint64_t max_latency_ns() const noexcept { return max_latency_ns_.load(std::memory_order_relaxed); }
+};
+
+} // namespace detail
+} // namespace midll
@@ -11,7 +11,10 @@
 
 #include <midll/config.hpp>
 #include <midll/detail/system_error.hpp>
+#include <midll/detail/unload_reaper.hpp>
 #include <midll/detail/windows/path_from_handle.hpp>
+#include <midll/link_namespace.hpp>
+#include <midll/loader_observer.hpp>
 #include <midll/shared_library_load_mode.hpp>
 
 namespace midll
@@ -26,6 +29,7 @@ public:
 
     shared_library_impl() noexcept
         : handle_(NULL)
+        , deferred_unload_(false)
     {
     }
 
@@ -36,8 +40,10 @@ public:
 
     shared_library_impl(shared_library_impl&& sl) noexcept
         : handle_(sl.handle_)
+        , deferred_unload_(sl.deferred_unload_)
     {
         sl.handle_ = NULL;
+        sl.deferred_unload_ = false;
     }
 
     shared_library_impl& operator=(shared_library_impl&& sl) noexcept
@@ -53,13 +59,20 @@ public:
         return actual_path;
     }
 
-    void load(midll::fs::path sl, load_mode::type portable_mode, midll::fs::error_code& ec)
+    void load(midll::fs::path sl, load_mode::type portable_mode, midll::fs::error_code& ec,
+              link_namespace ns = link_namespace::base())
     {
         using native_mode_t = DWORD;
         native_mode_t native_mode = static_cast<native_mode_t>(portable_mode);
         unload();
 
+        if (ns != link_namespace::base()) {
+            ec = midll::fs::make_error_code(midll::fs::errc::operation_not_supported);
+            return;
+        }
+
         if (!sl.is_absolute() && !(native_mode & load_mode::search_system_folders)) {
+            midll::detail::observed_phase phase("resolve_path", sl);
             midll::fs::error_code current_path_ec;
             midll::fs::path prog_loc = midll::fs::current_path(current_path_ec);
 
@@ -69,6 +82,8 @@ public:
             }
         }
         native_mode = static_cast<unsigned>(native_mode) & ~static_cast<unsigned>(load_mode::search_system_folders);
+        native_mode = static_cast<unsigned>(native_mode) & ~static_cast<unsigned>(load_mode::deferred_unload);
+        deferred_unload_ = !!(portable_mode & load_mode::deferred_unload);
 
         // Trying to open with appended decorations
         if (!!(native_mode & load_mode::append_decorations)) {
@@ -95,10 +110,13 @@ public:
         // we have some path. So we do not check for path, only for extension. We can not be sure that
         // such behavior remain across all platforms, so we add L"." by hand.
         if (sl.has_extension()) {
+            midll::detail::observed_phase phase("open", sl);
             handle_ = LoadLibraryExW(sl.c_str(), 0, native_mode);
         }
         else {
-            handle_ = LoadLibraryExW((sl.native() + L".").c_str(), 0, native_mode);
+            const midll::fs::path dotted = sl.native() + L".";
+            midll::detail::observed_phase phase("open", dotted);
+            handle_ = LoadLibraryExW(dotted.c_str(), 0, native_mode);
         }
 
         // LoadLibraryExW method is capable of self loading from program_location() path. No special actions
@@ -108,17 +126,56 @@ public:
         }
     }
 
+    void find_loaded(const midll::fs::path& sl, midll::fs::error_code& ec)
+    {
+        unload();
+
+        // Increments the reference count of an already loaded module and never loads a new one
+        if (!GetModuleHandleExW(0, sl.c_str(), &handle_)) {
+            handle_ = NULL;
+            ec = midll::detail::last_error_code();
+        }
+    }
+
     bool is_loaded() const noexcept { return (handle_ != 0); }
 
     void unload() noexcept
     {
         if (handle_) {
-            FreeLibrary(handle_);
+            if (deferred_unload_) {
+                midll::detail::unload_reaper::enqueue(handle_, [](void* h) noexcept {
+                    FreeLibrary(static_cast<HMODULE>(h));
+                });
+            }
+            else {
+                FreeLibrary(handle_);
+            }
             handle_ = 0;
         }
+        deferred_unload_ = false;
     }
 
-    void swap(shared_library_impl& rhs) noexcept { std::swap(handle_, rhs.handle_); }
+    void swap(shared_library_impl& rhs) noexcept
+    {
+        std::swap(handle_, rhs.handle_);
+        std::swap(deferred_unload_, rhs.deferred_unload_);
+    }
+
+    bool is_unload_deferred() const noexcept { return handle_ && deferred_unload_; }
+    void defer_unload(bool deferred) noexcept { deferred_unload_ = (deferred && is_loaded()); }
+
+    std::size_t huge_text_pages() const noexcept { return 0; }
+
+    void lock_in_memory(midll::fs::error_code& ec) noexcept
+    {
+        ec = midll::fs::make_error_code(midll::fs::errc::operation_not_supported);
+    }
+
+    void unlock_in_memory() noexcept {}
+
+    bool is_locked_in_memory() const noexcept { return false; }
+
+    link_namespace namespace_id() const noexcept { return link_namespace::base(); }
 
     midll::fs::path full_module_path(midll::fs::error_code& ec) const
     {
@@ -155,7 +212,10 @@ private:
     // Returns true if this load attempt should be the last one.
     bool load_impl(const midll::fs::path& load_path, DWORD mode, midll::fs::error_code& ec)
     {
-        handle_ = LoadLibraryExW(load_path.c_str(), 0, mode);
+        {
+            midll::detail::observed_phase phase("open", load_path);
+            handle_ = LoadLibraryExW(load_path.c_str(), 0, mode);
+        }
         if (handle_) {
             return true;
         }
@@ -178,6 +238,7 @@ private:
     }
 
     native_handle_t handle_;
+    bool deferred_unload_;
 };
 
 } // namespace detail
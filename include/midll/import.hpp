@@ -7,6 +7,11 @@
 
 #pragma once
 
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+
 #include <midll/config.hpp>
 #include <midll/shared_library.hpp>
 
@@ -17,6 +22,61 @@
 
 namespace midll
 {
+
+/*!
+ * \brief Non-owning handle to a function from a shared library.
+ *
+ * Unlike the callable objects returned by \forcedlink{import_symbol} the handle does not refcount the library: it
+ * is a trivially copyable wrapper around a function pointer, so copying it into tasks, lambdas and containers costs
+ * no atomic operations. The user must make sure that the library stays loaded while the handle is used,
+ * for example by keeping the owning object returned by \forcedlink{import_symbol} alive:
+ *
+ * \b Example:
+ * \code
+ * auto owner = midll::import_symbol<int(int)>("test_lib.so", "integer_func_name");
+ * midll::borrowed_function<int(int)> f = owner.borrow(); // valid while `owner` is alive
+ * pool.run([f]() { f(42); });
+ * \endcode
+ *
+ * \tparam T Function type.
+ */
+template<class T>
+class borrowed_function
+{
+    static_assert(std::is_function_v<T>, "midll::borrowed_function<T> supports only function types");
+
+    T* f_ = nullptr;
+
+public:
+    /// Constructs an empty handle.
+    constexpr borrowed_function() noexcept = default;
+
+    /// Constructs a handle to the function, for example to the one returned by shared_library::get().
+    constexpr borrowed_function(T& f) noexcept
+        : f_(&f)
+    {
+    }
+
+    /// Constructs a handle from the function pointer, that could be nullptr.
+    constexpr explicit borrowed_function(T* f) noexcept
+        : f_(f)
+    {
+    }
+
+    /// \return Pointer to the function or nullptr if the handle is empty.
+    constexpr T* get() const noexcept { return f_; }
+
+    /// \return true if the handle is not empty.
+    constexpr explicit operator bool() const noexcept { return !!f_; }
+
+    /// Calls the function. Behavior is undefined if the handle is empty or if the library was unloaded.
+    template<class... Args>
+    inline auto operator()(Args&&... args) const -> decltype((*f_)(static_cast<Args&&>(args)...))
+    {
+        return (*f_)(static_cast<Args&&>(args)...);
+    }
+};
+
 namespace detail
 {
 
@@ -27,11 +87,19 @@ class library_function
     std::shared_ptr<T> f_;
 
 public:
+    library_function() noexcept = default;
+
     inline library_function(const std::shared_ptr<shared_library>& lib, T* func_ptr) noexcept
         : f_(lib, func_ptr)
     {
     }
 
+    // Default constructed or returned by a failed `try_import_*` function objects are empty.
+    explicit operator bool() const noexcept { return !!f_; }
+
+    // Returns a non-owning handle that does not keep the library loaded.
+    borrowed_function<T> borrow() const noexcept { return borrowed_function<T>(f_.get()); }
+
     // Compilation error at this point means that imported function
     // was called with unmatching parameters.
     //
@@ -47,6 +115,70 @@ public:
     }
 };
 
+template<class T>
+class lazy_function;
+
+template<class R, class... Args>
+class lazy_function<R(Args...)>
+{
+    using function_ptr_t = R (*)(Args...);
+
+    struct state
+    {
+        midll::fs::path path;
+        std::string name;
+        load_mode::type mode;
+        bool alias;
+
+        std::atomic<function_ptr_t> func{nullptr};
+        std::once_flag once;
+        shared_library lib;
+
+        state(const midll::fs::path& p, std::string n, load_mode::type m, bool a)
+            : path(p)
+            , name(std::move(n))
+            , mode(m)
+            , alias(a)
+        {
+        }
+
+        function_ptr_t bind()
+        {
+            // std::call_once allows another attempt if the previous one has thrown
+            std::call_once(once, [this]() {
+                lib.load(path, mode);
+                function_ptr_t f = (alias ? lib.get<function_ptr_t>(name) : &lib.get<R(Args...)>(name));
+                func.store(f, std::memory_order_release);
+            });
+            return func.load(std::memory_order_relaxed);
+        }
+    };
+
+    std::shared_ptr<state> s_;
+
+public:
+    lazy_function(const midll::fs::path& path, std::string name, load_mode::type mode, bool alias)
+        : s_(std::make_shared<state>(path, std::move(name), mode, alias))
+    {
+    }
+
+    // Returns true if the library was loaded and the function was resolved.
+    bool is_bound() const noexcept { return !!s_->func.load(std::memory_order_acquire); }
+
+    // Compilation error at this point means that imported function
+    // was called with unmatching parameters.
+    template<class... CallArgs>
+    inline R operator()(CallArgs&&... args) const
+    {
+        // On the most popular platforms the acquire load is an ordinary load
+        function_ptr_t f = s_->func.load(std::memory_order_acquire);
+        if (!f) {
+            f = s_->bind();
+        }
+        return f(static_cast<CallArgs&&>(args)...);
+    }
+};
+
 template<class T>
 struct import_type
 {
@@ -101,7 +233,7 @@ auto import_symbol(const midll::fs::path& lib, const char* name, load_mode::type
 template<class T>
 auto import_symbol(const midll::fs::path& lib, const std::string& name, load_mode::type mode = load_mode::default_mode)
 {
-    return dll::import_symbol<T>(lib, name.c_str(), mode);
+    return midll::import_symbol<T>(lib, name.c_str(), mode);
 }
 
 //! \overload midll::import_symbol(const midll::fs::path& lib, const char* name, load_mode::type mode)
@@ -118,7 +250,7 @@ auto import_symbol(const shared_library& lib, const char* name)
 template<class T>
 auto import_symbol(const shared_library& lib, const std::string& name)
 {
-    return dll::import_symbol<T>(lib, name.c_str());
+    return midll::import_symbol<T>(lib, name.c_str());
 }
 
 //! \overload midll::import_symbol(const midll::fs::path& lib, const char* name, load_mode::type mode)
@@ -135,7 +267,7 @@ auto import_symbol(shared_library&& lib, const char* name)
 template<class T>
 auto import_symbol(shared_library&& lib, const std::string& name)
 {
-    return dll::import_symbol<T>(std::move(lib), name.c_str());
+    return midll::import_symbol<T>(std::move(lib), name.c_str());
 }
 
 /*!
@@ -188,7 +320,7 @@ auto import_alias(const midll::fs::path& lib, const char* name, load_mode::type
 template<class T>
 auto import_alias(const midll::fs::path& lib, const std::string& name, load_mode::type mode = load_mode::default_mode)
 {
-    return dll::import_alias<T>(lib, name.c_str(), mode);
+    return midll::import_alias<T>(lib, name.c_str(), mode);
 }
 
 //! \overload midll::import_alias(const midll::fs::path& lib, const char* name, load_mode::type mode)
@@ -205,7 +337,7 @@ auto import_alias(const shared_library& lib, const char* name)
 template<class T>
 auto import_alias(const shared_library& lib, const std::string& name)
 {
-    return dll::import_alias<T>(lib, name.c_str());
+    return midll::import_alias<T>(lib, name.c_str());
 }
 
 //! \overload midll::import_alias(const midll::fs::path& lib, const char* name, load_mode::type mode)
@@ -222,7 +354,361 @@ auto import_alias(shared_library&& lib, const char* name)
 template<class T>
 auto import_alias(shared_library&& lib, const std::string& name)
 {
-    return dll::import_alias<T>(std::move(lib), name.c_str());
+    return midll::import_alias<T>(std::move(lib), name.c_str());
+}
+
+/*!
+ * Same as \forcedlink{import_symbol} but allocates the midll::shared_library and the reference counter of the
+ * returned object with `std::allocate_shared`, so that handles of a subsystem could be kept in its own arena or
+ * pool. The allocator must stay usable until the last copy of the returned object is destroyed.
+ *
+ * \b Example:
+ * \code
+ * arena_allocator<char> alloc(plugin_arena);
+ * auto f = midll::import_symbol<int(int)>(std::allocator_arg, alloc, "test_lib.so", "integer_func_name");
+ * \endcode
+ *
+ * \b Template \b parameter \b T:    Type of the symbol that we are going to import. Must be explicitly specified.
+ *
+ * \param alloc Allocator that satisfies the requirements of `std::allocate_shared`.
+ * \param lib Path to shared library or shared library to load function from.
+ * \param name Null-terminated C or C++ mangled name of the function to import. Can handle std::string, char*, const
+ * char*.
+ * \param mode An mode that will be used on library load.
+ *
+ * \return callable object if T is a function type, or std::shared_ptr<T> if T is an object type.
+ *
+ * \throw \forcedlinkfs{system_error} if symbol does not exist or if the DLL/DSO was not loaded.
+ *       Also throws whatever the allocator throws.
+ */
+template<class T, class Alloc>
+auto import_symbol(std::allocator_arg_t, const Alloc& alloc, const midll::fs::path& lib, const char* name,
+                   load_mode::type mode = load_mode::default_mode)
+{
+    using type = typename midll::detail::import_type<T>::base_type;
+
+    std::shared_ptr<midll::shared_library> p = std::allocate_shared<midll::shared_library>(alloc, lib, mode);
+    return type(p, std::addressof(p->get<T>(name)));
+}
+
+//! \overload midll::import_symbol(std::allocator_arg_t, const Alloc&, const fs::path&, const char*, load_mode::type)
+template<class T, class Alloc>
+auto import_symbol(std::allocator_arg_t, const Alloc& alloc, const midll::fs::path& lib, const std::string& name,
+                   load_mode::type mode = load_mode::default_mode)
+{
+    return midll::import_symbol<T>(std::allocator_arg, alloc, lib, name.c_str(), mode);
+}
+
+//! \overload midll::import_symbol(std::allocator_arg_t, const Alloc&, const fs::path&, const char*, load_mode::type)
+template<class T, class Alloc>
+auto import_symbol(std::allocator_arg_t, const Alloc& alloc, const shared_library& lib, const char* name)
+{
+    using type = typename midll::detail::import_type<T>::base_type;
+
+    std::shared_ptr<midll::shared_library> p = std::allocate_shared<midll::shared_library>(alloc, lib);
+    return type(p, std::addressof(p->get<T>(name)));
+}
+
+//! \overload midll::import_symbol(std::allocator_arg_t, const Alloc&, const fs::path&, const char*, load_mode::type)
+template<class T, class Alloc>
+auto import_symbol(std::allocator_arg_t, const Alloc& alloc, const shared_library& lib, const std::string& name)
+{
+    return midll::import_symbol<T>(std::allocator_arg, alloc, lib, name.c_str());
+}
+
+//! \overload midll::import_symbol(std::allocator_arg_t, const Alloc&, const fs::path&, const char*, load_mode::type)
+template<class T, class Alloc>
+auto import_symbol(std::allocator_arg_t, const Alloc& alloc, shared_library&& lib, const char* name)
+{
+    using type = typename midll::detail::import_type<T>::base_type;
+
+    std::shared_ptr<midll::shared_library> p = std::allocate_shared<midll::shared_library>(alloc, std::move(lib));
+    return type(p, std::addressof(p->get<T>(name)));
+}
+
+//! \overload midll::import_symbol(std::allocator_arg_t, const Alloc&, const fs::path&, const char*, load_mode::type)
+template<class T, class Alloc>
+auto import_symbol(std::allocator_arg_t, const Alloc& alloc, shared_library&& lib, const std::string& name)
+{
+    return midll::import_symbol<T>(std::allocator_arg, alloc, std::move(lib), name.c_str());
+}
+
+/*!
+ * Same as \forcedlink{import_alias} but allocates the midll::shared_library and the reference counter of the
+ * returned object with `std::allocate_shared`. The allocator must stay usable until the last copy of the returned
+ * object is destroyed.
+ *
+ * \b Template \b parameter \b T:    Type of the symbol alias that we are going to import. Must be explicitly specified.
+ *
+ * \param alloc Allocator that satisfies the requirements of `std::allocate_shared`.
+ * \param lib Path to shared library or shared library to load function from.
+ * \param name Null-terminated name of the alias to import. Can handle std::string, char*, const char*.
+ * \param mode An mode that will be used on library load.
+ *
+ * \return callable object if T is a function type, or std::shared_ptr<T> if T is an object type.
+ *
+ * \throw \forcedlinkfs{system_error} if symbol does not exist or if the DLL/DSO was not loaded.
+ *       Also throws whatever the allocator throws.
+ */
+template<class T, class Alloc>
+auto import_alias(std::allocator_arg_t, const Alloc& alloc, const midll::fs::path& lib, const char* name,
+                  load_mode::type mode = load_mode::default_mode)
+{
+    using type = typename midll::detail::import_type<T>::base_type;
+
+    std::shared_ptr<midll::shared_library> p = std::allocate_shared<midll::shared_library>(alloc, lib, mode);
+    return type(p, p->get<T*>(name));
+}
+
+//! \overload midll::import_alias(std::allocator_arg_t, const Alloc&, const fs::path&, const char*, load_mode::type)
+template<class T, class Alloc>
+auto import_alias(std::allocator_arg_t, const Alloc& alloc, const midll::fs::path& lib, const std::string& name,
+                  load_mode::type mode = load_mode::default_mode)
+{
+    return midll::import_alias<T>(std::allocator_arg, alloc, lib, name.c_str(), mode);
+}
+
+//! \overload midll::import_alias(std::allocator_arg_t, const Alloc&, const fs::path&, const char*, load_mode::type)
+template<class T, class Alloc>
+auto import_alias(std::allocator_arg_t, const Alloc& alloc, const shared_library& lib, const char* name)
+{
+    using type = typename midll::detail::import_type<T>::base_type;
+
+    std::shared_ptr<midll::shared_library> p = std::allocate_shared<midll::shared_library>(alloc, lib);
+    return type(p, p->get<T*>(name));
+}
+
+//! \overload midll::import_alias(std::allocator_arg_t, const Alloc&, const fs::path&, const char*, load_mode::type)
+template<class T, class Alloc>
+auto import_alias(std::allocator_arg_t, const Alloc& alloc, const shared_library& lib, const std::string& name)
+{
+    return midll::import_alias<T>(std::allocator_arg, alloc, lib, name.c_str());
+}
+
+//! \overload midll::import_alias(std::allocator_arg_t, const Alloc&, const fs::path&, const char*, load_mode::type)
+template<class T, class Alloc>
+auto import_alias(std::allocator_arg_t, const Alloc& alloc, shared_library&& lib, const char* name)
+{
+    using type = typename midll::detail::import_type<T>::base_type;
+
+    std::shared_ptr<midll::shared_library> p = std::allocate_shared<midll::shared_library>(alloc, std::move(lib));
+    return type(p, p->get<T*>(name));
+}
+
+//! \overload midll::import_alias(std::allocator_arg_t, const Alloc&, const fs::path&, const char*, load_mode::type)
+template<class T, class Alloc>
+auto import_alias(std::allocator_arg_t, const Alloc& alloc, shared_library&& lib, const std::string& name)
+{
+    return midll::import_alias<T>(std::allocator_arg, alloc, std::move(lib), name.c_str());
+}
+
+namespace detail
+{
+
+template<class T>
+auto try_import_impl(shared_library&& lib, T* symbol)
+{
+    using type = typename midll::detail::import_type<T>::base_type;
+
+    if (!symbol) {
+        return type();
+    }
+
+    std::shared_ptr<midll::shared_library> p = std::make_shared<midll::shared_library>(std::move(lib));
+    return type(p, symbol);
+}
+
+} // namespace detail
+
+/*!
+ * Same as \forcedlink{import_symbol} but reports errors via \forcedlinkfs{error_code} and returns an empty
+ * callable object or std::shared_ptr<T> if the library could not be loaded or there is no such symbol.
+ * Nothing is allocated for a missing symbol, so the function is suitable for probing optional symbols. A library
+ * passed by rvalue reference is moved from only on success.
+ *
+ * \b Example:
+ * \code
+ * midll::fs::error_code ec;
+ * auto f = midll::try_import_symbol<int(int)>("test_lib.so", "optional_function", ec);
+ * if (f) {
+ *     f(42);
+ * }
+ * \endcode
+ *
+ * \b Template \b parameter \b T:    Type of the symbol that we are going to import. Must be explicitly specified.
+ *
+ * \param lib Path to shared library or shared library to load function from.
+ * \param name Null-terminated C or C++ mangled name of the function to import. Can handle std::string, char*, const
+ * char*.
+ * \param ec Variable that will be set to the result of the operation.
+ * \param mode An mode that will be used on library load.
+ *
+ * \return callable object if T is a function type, or std::shared_ptr<T> if T is an object type. Empty on error.
+ *
+ * \throw std::bad_alloc in case of insufficient memory.
+ */
+template<class T>
+auto try_import_symbol(const midll::fs::path& lib, const char* name, midll::fs::error_code& ec,
+                       load_mode::type mode = load_mode::default_mode)
+{
+    midll::shared_library l(lib, ec, mode);
+    T* const symbol = (ec ? nullptr : l.try_get<T>(name, ec));
+    return midll::detail::try_import_impl<T>(std::move(l), symbol);
+}
+
+//! \overload midll::try_import_symbol(const midll::fs::path&, const char*, midll::fs::error_code&, load_mode::type)
+template<class T>
+auto try_import_symbol(const midll::fs::path& lib, const std::string& name, midll::fs::error_code& ec,
+                       load_mode::type mode = load_mode::default_mode)
+{
+    return midll::try_import_symbol<T>(lib, name.c_str(), ec, mode);
+}
+
+//! \overload midll::try_import_symbol(const midll::fs::path&, const char*, midll::fs::error_code&, load_mode::type)
+template<class T>
+auto try_import_symbol(const shared_library& lib, const char* name, midll::fs::error_code& ec)
+{
+    T* const symbol = lib.try_get<T>(name, ec);
+    return midll::detail::try_import_impl<T>(symbol ? shared_library(lib) : shared_library(), symbol);
+}
+
+//! \overload midll::try_import_symbol(const midll::fs::path&, const char*, midll::fs::error_code&, load_mode::type)
+template<class T>
+auto try_import_symbol(const shared_library& lib, const std::string& name, midll::fs::error_code& ec)
+{
+    return midll::try_import_symbol<T>(lib, name.c_str(), ec);
+}
+
+//! \overload midll::try_import_symbol(const midll::fs::path&, const char*, midll::fs::error_code&, load_mode::type)
+template<class T>
+auto try_import_symbol(shared_library&& lib, const char* name, midll::fs::error_code& ec)
+{
+    T* const symbol = lib.try_get<T>(name, ec);
+    return midll::detail::try_import_impl<T>(std::move(lib), symbol);
+}
+
+//! \overload midll::try_import_symbol(const midll::fs::path&, const char*, midll::fs::error_code&, load_mode::type)
+template<class T>
+auto try_import_symbol(shared_library&& lib, const std::string& name, midll::fs::error_code& ec)
+{
+    return midll::try_import_symbol<T>(std::move(lib), name.c_str(), ec);
+}
+
+/*!
+ * Same as \forcedlink{import_alias} but reports errors via \forcedlinkfs{error_code} and returns an empty
+ * callable object or std::shared_ptr<T> if the library could not be loaded or there is no such alias.
+ * Nothing is allocated for a missing alias. A library passed by rvalue reference is moved from only on success.
+ *
+ * \b Template \b parameter \b T:    Type of the symbol alias that we are going to import. Must be explicitly specified.
+ *
+ * \param lib Path to shared library or shared library to load function from.
+ * \param name Null-terminated C or C++ mangled name of the function or variable to import. Can handle std::string,
+ * char*, const char*.
+ * \param ec Variable that will be set to the result of the operation.
+ * \param mode An mode that will be used on library load.
+ *
+ * \return callable object if T is a function type, or std::shared_ptr<T> if T is an object type. Empty on error.
+ *
+ * \throw std::bad_alloc in case of insufficient memory.
+ */
+template<class T>
+auto try_import_alias(const midll::fs::path& lib, const char* name, midll::fs::error_code& ec,
+                      load_mode::type mode = load_mode::default_mode)
+{
+    midll::shared_library l(lib, ec, mode);
+    T* const symbol = (ec ? nullptr : l.try_get_alias<T>(name, ec));
+    return midll::detail::try_import_impl<T>(std::move(l), symbol);
+}
+
+//! \overload midll::try_import_alias(const midll::fs::path&, const char*, midll::fs::error_code&, load_mode::type)
+template<class T>
+auto try_import_alias(const midll::fs::path& lib, const std::string& name, midll::fs::error_code& ec,
+                      load_mode::type mode = load_mode::default_mode)
+{
+    return midll::try_import_alias<T>(lib, name.c_str(), ec, mode);
+}
+
+//! \overload midll::try_import_alias(const midll::fs::path&, const char*, midll::fs::error_code&, load_mode::type)
+template<class T>
+auto try_import_alias(const shared_library& lib, const char* name, midll::fs::error_code& ec)
+{
+    T* const symbol = lib.try_get_alias<T>(name, ec);
+    return midll::detail::try_import_impl<T>(symbol ? shared_library(lib) : shared_library(), symbol);
+}
+
+//! \overload midll::try_import_alias(const midll::fs::path&, const char*, midll::fs::error_code&, load_mode::type)
+template<class T>
+auto try_import_alias(const shared_library& lib, const std::string& name, midll::fs::error_code& ec)
+{
+    return midll::try_import_alias<T>(lib, name.c_str(), ec);
+}
+
+//! \overload midll::try_import_alias(const midll::fs::path&, const char*, midll::fs::error_code&, load_mode::type)
+template<class T>
+auto try_import_alias(shared_library&& lib, const char* name, midll::fs::error_code& ec)
+{
+    T* const symbol = lib.try_get_alias<T>(name, ec);
+    return midll::detail::try_import_impl<T>(std::move(lib), symbol);
+}
+
+//! \overload midll::try_import_alias(const midll::fs::path&, const char*, midll::fs::error_code&, load_mode::type)
+template<class T>
+auto try_import_alias(shared_library&& lib, const std::string& name, midll::fs::error_code& ec)
+{
+    return midll::try_import_alias<T>(std::move(lib), name.c_str(), ec);
+}
+
+/*!
+ * Returns callable object that loads the library and resolves the function on the first call. Use it for the rarely
+ * used functions to avoid loading libraries and resolving symbols at startup.
+ *
+ * First call is thread safe. If it fails, the exception is propagated to the caller and the next call makes another
+ * attempt. After a successful first call each call is an indirect call through the resolved pointer. Copies of the
+ * returned object share the loaded library, which stays loaded until all the copies are destroyed.
+ *
+ * \b Example:
+ * \code
+ * auto f = midll::import_lazy<int(int)>("test_lib.so", "integer_func_name"); // nothing is loaded
+ * f(42);                                                                     // loads test_lib.so
+ * \endcode
+ *
+ * \b Template \b parameter \b T:    Type of the function that we are going to import. Must be explicitly specified.
+ *
+ * \param lib Path to shared library to load function from.
+ * \param name C or C++ mangled name of the function to import. Can handle std::string, char*, const char*.
+ * \param mode An mode that will be used on library load.
+ *
+ * \return callable object.
+ *
+ * \throw std::bad_alloc in case of insufficient memory. The returned object throws \forcedlinkfs{system_error} on
+ * the first call if the library could not be loaded or there is no such symbol.
+ */
+template<class T>
+auto import_lazy(const midll::fs::path& lib, std::string name, load_mode::type mode = load_mode::default_mode)
+{
+    static_assert(std::is_function_v<T>, "midll::import_lazy<T>() supports only function types");
+    return midll::detail::lazy_function<T>(lib, std::move(name), mode, false);
+}
+
+/*!
+ * Same as \forcedlink{import_lazy} but resolves the function by its alias name.
+ *
+ * \b Template \b parameter \b T:    Type of the function that we are going to import. Must be explicitly specified.
+ *
+ * \param lib Path to shared library to load function from.
+ * \param name Alias name of the function to import. Can handle std::string, char*, const char*.
+ * \param mode An mode that will be used on library load.
+ *
+ * \return callable object.
+ *
+ * \throw std::bad_alloc in case of insufficient memory. The returned object throws \forcedlinkfs{system_error} on
+ * the first call if the library could not be loaded or there is no such alias.
+ */
+template<class T>
+auto import_alias_lazy(const midll::fs::path& lib, std::string name, load_mode::type mode = load_mode::default_mode)
+{
+    static_assert(std::is_function_v<T>, "midll::import_alias_lazy<T>() supports only function types");
+    return midll::detail::lazy_function<T>(lib, std::move(name), mode, true);
 }
 
 } // namespace midll
@@ -0,0 +1,414 @@
+// Copyright Antony Polukhin, 2015-2024.
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include <midll/config.hpp>
+#include <midll/detail/system_error.hpp>
+#include <midll/import.hpp>
+#include <midll/loader_observer.hpp>
+#include <midll/shared_library.hpp>
+
+/// \file midll/import_set.hpp
+/// \brief Contains the midll::import_set class that imports any number of symbols from a library loaded once.
+
+namespace midll
+{
+
+/*!
+ * \brief Library loaded once that hands out imported functions and variables sharing a single reference count.
+ *
+ * Each \forcedlink{import_symbol} call creates its own copy of midll::shared_library, so importing 30 functions
+ * from a plugin results in 30 library references and 30 control blocks. Objects returned by import_set refer to the
+ * single midll::shared_library owned by the set, the library is unloaded when the set and all the imported
+ * objects are destroyed.
+ *
+ * Symbols could be imported one by one, or in bulk via get_all() that reports all the missing symbols at once.
+ *
+ * \b Example:
+ * \code
+ * midll::import_set plugin("plugin.so");
+ * auto [create, destroy, version] = plugin.get_all<void*(), void(void*), const int>({"create", "destroy", "version"});
+ * auto log = plugin.get<void(const char*)>("log");
+ * \endcode
+ */
+class import_set
+{
+    std::shared_ptr<shared_library> lib_;
+
+    template<class T>
+    using imported_t = typename midll::detail::import_type<T>::base_type;
+
+    template<class T, bool Alias>
+    imported_t<T> try_get_impl(const char* name, std::vector<std::string>& missing) const
+    {
+        midll::fs::error_code ec;
+        T* const symbol = (Alias ? lib_->try_get_alias<T>(name, ec) : lib_->try_get<T>(name, ec));
+        if (!symbol) {
+            missing.emplace_back(name);
+            return imported_t<T>();
+        }
+
+        return imported_t<T>(lib_, symbol);
+    }
+
+    template<bool Alias, class... T, std::size_t... I>
+    std::tuple<imported_t<T>...> get_all_impl(const char* const* names, std::vector<std::string>& missing,
+                                              std::index_sequence<I...>) const
+    {
+        midll::fs::path subject;
+        if (midll::detail::current_loader_observer()) {
+            midll::fs::error_code ignore;
+            subject = lib_->location(ignore);
+        }
+        midll::detail::observed_phase phase("bind", subject);
+
+        // Braced initialization guarantees left to right evaluation, so `missing` keeps the order of the names
+        return std::tuple<imported_t<T>...>{try_get_impl<T, Alias>(names[I], missing)...};
+    }
+
+    template<bool Alias, class... T>
+    std::tuple<imported_t<T>...> try_get_all_impl(const char* const* names, midll::fs::error_code& ec,
+                                                  std::vector<std::string>& missing) const
+    {
+        ec.clear();
+        missing.clear();
+        if (!is_loaded()) {
+            ec = midll::fs::make_error_code(midll::fs::errc::bad_file_descriptor);
+            return std::tuple<imported_t<T>...>();
+        }
+
+        std::tuple<imported_t<T>...> result =
+            get_all_impl<Alias, T...>(names, missing, std::index_sequence_for<T...>());
+        if (!missing.empty()) {
+            ec = midll::fs::make_error_code(midll::fs::errc::invalid_seek);
+        }
+        return result;
+    }
+
+    template<bool Alias, class... T>
+    std::tuple<imported_t<T>...> get_all_throwing_impl(const char* const* names, const char* function) const
+    {
+        midll::fs::error_code ec;
+        std::vector<std::string> missing;
+        std::tuple<imported_t<T>...> result = try_get_all_impl<Alias, T...>(names, ec, missing);
+        if (!ec) {
+            return result;
+        }
+
+        std::string message = std::string("midll::import_set::") + function + "() failed";
+        if (missing.empty()) {
+            message += ": no library was loaded";
+        }
+        else {
+            message += ", missing symbols: ";
+            for (std::size_t i = 0; i < missing.size(); ++i) {
+                message += (i ? ", " : "");
+                message += missing[i];
+            }
+        }
+        throw midll::fs::system_error(ec, message);
+    }
+
+public:
+    /*!
+     * Creates an empty set.
+     *
+     * \post this->is_loaded() returns false.
+     * \throw Nothing.
+     */
+    import_set() noexcept = default;
+
+    /*!
+     * Loads the library, see shared_library::load(const midll::fs::path&, load_mode::type).
+     *
+     * \param lib_path Library file name. Can handle std::string, const char*, std::wstring,
+     * const wchar_t* or \forcedlinkfs{path}.
+     * \param mode A mode that will be used on library load.
+     * \throw \forcedlinkfs{system_error}, std::bad_alloc in case of insufficient memory.
+     */
+    explicit import_set(const midll::fs::path& lib_path, load_mode::type mode = load_mode::default_mode)
+        : lib_(std::make_shared<shared_library>(lib_path, mode))
+    {
+    }
+
+    /*!
+     * Loads the library, see shared_library::load(const midll::fs::path&, midll::fs::error_code&, load_mode::type).
+     *
+     * \param lib_path Library file name. Can handle std::string, const char*, std::wstring,
+     * const wchar_t* or \forcedlinkfs{path}.
+     * \param ec Variable that will be set to the result of the operation.
+     * \param mode A mode that will be used on library load.
+     * \throw std::bad_alloc in case of insufficient memory.
+     */
+    import_set(const midll::fs::path& lib_path, midll::fs::error_code& ec,
+               load_mode::type mode = load_mode::default_mode)
+        : lib_(std::make_shared<shared_library>(lib_path, ec, mode))
+    {
+    }
+
+    /*!
+     * Takes a reference to an already loaded library.
+     *
+     * \param lib Library to import symbols from.
+     * \throw \forcedlinkfs{system_error}, std::bad_alloc in case of insufficient memory.
+     */
+    explicit import_set(const shared_library& lib)
+        : lib_(std::make_shared<shared_library>(lib))
+    {
+    }
+
+    //! \overload import_set(const shared_library& lib)
+    explicit import_set(shared_library&& lib)
+        : lib_(std::make_shared<shared_library>(std::move(lib)))
+    {
+    }
+
+    /*!
+     * Same as import_set(const midll::fs::path&, load_mode::type) but allocates the midll::shared_library and the
+     * reference counter shared by the imported symbols with `std::allocate_shared`. The allocator must stay usable
+     * until the set and all the imported symbols are destroyed.
+     *
+     * \b Example:
+     * \code
+     * midll::import_set plugin(std::allocator_arg, arena_allocator<char>(plugin_arena), "plugin.so");
+     * \endcode
+     *
+     * \param alloc Allocator that satisfies the requirements of `std::allocate_shared`.
+     * \param lib_path Library file name. Can handle std::string, const char*, std::wstring,
+     * const wchar_t* or \forcedlinkfs{path}.
+     * \param mode A mode that will be used on library load.
+     * \throw \forcedlinkfs{system_error}, whatever the allocator throws.
+     */
+    template<class Alloc>
+    import_set(std::allocator_arg_t, const Alloc& alloc, const midll::fs::path& lib_path,
+               load_mode::type mode = load_mode::default_mode)
+        : lib_(std::allocate_shared<shared_library>(alloc, lib_path, mode))
+    {
+    }
+
+    //! \overload import_set(std::allocator_arg_t, const Alloc&, const midll::fs::path&, load_mode::type)
+    template<class Alloc>
+    import_set(std::allocator_arg_t, const Alloc& alloc, const midll::fs::path& lib_path, midll::fs::error_code& ec,
+               load_mode::type mode = load_mode::default_mode)
+        : lib_(std::allocate_shared<shared_library>(alloc, lib_path, ec, mode))
+    {
+    }
+
+    //! \overload import_set(std::allocator_arg_t, const Alloc&, const midll::fs::path&, load_mode::type)
+    template<class Alloc>
+    import_set(std::allocator_arg_t, const Alloc& alloc, const shared_library& lib)
+        : lib_(std::allocate_shared<shared_library>(alloc, lib))
+    {
+    }
+
+    //! \overload import_set(std::allocator_arg_t, const Alloc&, const midll::fs::path&, load_mode::type)
+    template<class Alloc>
+    import_set(std::allocator_arg_t, const Alloc& alloc, shared_library&& lib)
+        : lib_(std::allocate_shared<shared_library>(alloc, std::move(lib)))
+    {
+    }
+
+    /// \return true if the set holds a loaded library.
+    bool is_loaded() const noexcept { return lib_ && lib_->is_loaded(); }
+
+    /// \return true if the set holds a loaded library.
+    explicit operator bool() const noexcept { return is_loaded(); }
+
+    /*!
+     * \return Library owned by the set.
+     * \throw \forcedlinkfs{system_error} if the set is empty.
+     */
+    const shared_library& library() const
+    {
+        if (!lib_) {
+            throw midll::fs::system_error(midll::fs::make_error_code(midll::fs::errc::bad_file_descriptor),
+                                          "midll::import_set::library() failed: no library was loaded");
+        }
+        return *lib_;
+    }
+
+    /*!
+     * Same as \forcedlink{import_symbol} for the library of the set, without copying the library.
+     *
+     * \tparam T Type of the symbol that we are going to import. Must be explicitly specified.
+     * \param name Null-terminated C or C++ mangled name of the function or variable to import. Can handle
+     * std::string, char*, const char*.
+     * \return callable object if T is a function type, or std::shared_ptr<T> if T is an object type.
+     * \throw \forcedlinkfs{system_error} if symbol does not exist or if the DLL/DSO was not loaded.
+     */
+    template<class T>
+    imported_t<T> get(const char* name) const
+    {
+        return imported_t<T>(lib_, std::addressof(library().get<T>(name)));
+    }
+
+    //! \overload imported_t<T> get(const char* name) const
+    template<class T>
+    imported_t<T> get(const std::string& name) const
+    {
+        return get<T>(name.c_str());
+    }
+
+    /*!
+     * Same as \forcedlink{import_alias} for the library of the set, without copying the library.
+     *
+     * \tparam T Type of the symbol alias that we are going to import. Must be explicitly specified.
+     * \param name Null-terminated name of the alias. Can handle std::string, char*, const char*.
+     * \return callable object if T is a function type, or std::shared_ptr<T> if T is an object type.
+     * \throw \forcedlinkfs{system_error} if symbol does not exist or if the DLL/DSO was not loaded.
+     */
+    template<class T>
+    imported_t<T> get_alias(const char* name) const
+    {
+        return imported_t<T>(lib_, library().get<T*>(name));
+    }
+
+    //! \overload imported_t<T> get_alias(const char* name) const
+    template<class T>
+    imported_t<T> get_alias(const std::string& name) const
+    {
+        return get_alias<T>(name.c_str());
+    }
+
+    /*!
+     * Same as get() but reports errors via \forcedlinkfs{error_code} and returns an empty object if there is no such
+     * symbol.
+     *
+     * \tparam T Type of the symbol that we are going to import. Must be explicitly specified.
+     * \param name Null-terminated C or C++ mangled name of the function or variable to import.
+     * \param ec Variable that will be set to the result of the operation.
+     * \return callable object if T is a function type, or std::shared_ptr<T> if T is an object type. Empty on error.
+     * \throw Nothing.
+     */
+    template<class T>
+    imported_t<T> try_get(const char* name, midll::fs::error_code& ec) const noexcept
+    {
+        if (!lib_) {
+            ec = midll::fs::make_error_code(midll::fs::errc::bad_file_descriptor);
+            return imported_t<T>();
+        }
+
+        T* const symbol = lib_->try_get<T>(name, ec);
+        return (symbol ? imported_t<T>(lib_, symbol) : imported_t<T>());
+    }
+
+    /*!
+     * Same as get_alias() but reports errors via \forcedlinkfs{error_code} and returns an empty object if there is
+     * no such alias.
+     *
+     * \tparam T Type of the symbol alias that we are going to import. Must be explicitly specified.
+     * \param name Null-terminated name of the alias.
+     * \param ec Variable that will be set to the result of the operation.
+     * \return callable object if T is a function type, or std::shared_ptr<T> if T is an object type. Empty on error.
+     * \throw Nothing.
+     */
+    template<class T>
+    imported_t<T> try_get_alias(const char* name, midll::fs::error_code& ec) const noexcept
+    {
+        if (!lib_) {
+            ec = midll::fs::make_error_code(midll::fs::errc::bad_file_descriptor);
+            return imported_t<T>();
+        }
+
+        T* const symbol = lib_->try_get_alias<T>(name, ec);
+        return (symbol ? imported_t<T>(lib_, symbol) : imported_t<T>());
+    }
+
+    /*!
+     * Imports several symbols at once. All the names are looked up even if some of them are missing, so the
+     * exception lists all the missing symbols. The lookups are reported to the loader observer as a single "bind"
+     * phase.
+     *
+     * \b Example:
+     * \code
+     * auto [f, i] = set.get_all<int(int), int>({"increment", "integer_g"});
+     * \endcode
+     *
+     * \tparam T Types of the symbols that we are going to import. Must be explicitly specified.
+     * \param names Null-terminated C or C++ mangled names of the functions or variables, one per type.
+     * \return std::tuple of callable objects and std::shared_ptr in the order of the types.
+     * \throw \forcedlinkfs{system_error} with all the missing names in what() if some symbols do not exist or if the
+     * DLL/DSO was not loaded.
+     */
+    template<class... T>
+    std::tuple<imported_t<T>...> get_all(const char* const (&names)[sizeof...(T)]) const
+    {
+        return get_all_throwing_impl<false, T...>(names, "get_all");
+    }
+
+    /*!
+     * Same as get_all() but reports errors via \forcedlinkfs{error_code}. Elements of the result that correspond to
+     * the missing symbols are empty.
+     *
+     * \tparam T Types of the symbols that we are going to import. Must be explicitly specified.
+     * \param names Null-terminated C or C++ mangled names of the functions or variables, one per type.
+     * \param ec Variable that will be set to `invalid_seek` if some symbols are missing or to `bad_file_descriptor`
+     * if the DLL/DSO was not loaded.
+     * \param missing Receives the names of all the missing symbols in the order of the `names`.
+     * \return std::tuple of callable objects and std::shared_ptr in the order of the types.
+     * \throw std::bad_alloc in case of insufficient memory.
+     */
+    template<class... T>
+    std::tuple<imported_t<T>...> try_get_all(const char* const (&names)[sizeof...(T)], midll::fs::error_code& ec,
+                                             std::vector<std::string>& missing) const
+    {
+        return try_get_all_impl<false, T...>(names, ec, missing);
+    }
+
+    //! \overload try_get_all(const char* const (&)[sizeof...(T)], midll::fs::error_code&, std::vector<std::string>&)
+    template<class... T>
+    std::tuple<imported_t<T>...> try_get_all(const char* const (&names)[sizeof...(T)], midll::fs::error_code& ec) const
+    {
+        std::vector<std::string> missing;
+        return try_get_all_impl<false, T...>(names, ec, missing);
+    }
+
+    /*!
+     * Same as get_all() but imports the symbols by alias names, see get_alias().
+     *
+     * \tparam T Types of the symbol aliases that we are going to import. Must be explicitly specified.
+     * \param names Null-terminated names of the aliases, one per type.
+     * \return std::tuple of callable objects and std::shared_ptr in the order of the types.
+     * \throw \forcedlinkfs{system_error} with all the missing names in what() if some aliases do not exist or if the
+     * DLL/DSO was not loaded.
+     */
+    template<class... T>
+    std::tuple<imported_t<T>...> get_all_alias(const char* const (&names)[sizeof...(T)]) const
+    {
+        return get_all_throwing_impl<true, T...>(names, "get_all_alias");
+    }
+
+    /*!
+     * Same as try_get_all() but imports the symbols by alias names, see get_alias().
+     *
+     * \tparam T Types of the symbol aliases that we are going to import. Must be explicitly specified.
+     * \param names Null-terminated names of the aliases, one per type.
+     * \param ec Variable that will be set to `invalid_seek` if some aliases are missing or to `bad_file_descriptor`
+     * if the DLL/DSO was not loaded.
+     * \param missing Receives the names of all the missing aliases in the order of the `names`.
+     * \return std::tuple of callable objects and std::shared_ptr in the order of the types.
+     * \throw std::bad_alloc in case of insufficient memory.
+     */
+    template<class... T>
+    std::tuple<imported_t<T>...> try_get_all_alias(const char* const (&names)[sizeof...(T)],
+                                                   midll::fs::error_code& ec, std::vector<std::string>& missing) const
+    {
+        return try_get_all_impl<true, T...>(names, ec, missing);
+    }
+
+    /// \return Count of the import_set objects and imported symbols that share the library, 0 for an empty set.
+    long use_count() const noexcept { return lib_.use_count(); }
+};
+
+} // namespace midll
@@ -13,6 +13,7 @@
 #include <midll/detail/elf_info.hpp>
 #include <midll/detail/macho_info.hpp>
 #include <midll/detail/pe_info.hpp>
+#include <midll/loader_observer.hpp>
 
 /// \file midll/library_info.hpp
 /// \brief Contains only the midll::library_info class that is capable of
@@ -29,6 +30,7 @@ class library_info
 {
 private:
     std::ifstream f_;
+    midll::fs::path path_;
 
     enum
     {
@@ -136,7 +138,9 @@ public:
      */
     explicit library_info(const midll::fs::path& library_path, bool throw_if_not_native_format = true)
         : f_(library_path, std::ios_base::in | std::ios_base::binary)
+        , path_(library_path)
     {
+        midll::detail::observed_phase phase("library_info", path_);
         f_.exceptions(std::ios_base::failbit | std::ifstream::badbit | std::ifstream::eofbit);
 
         init(throw_if_not_native_format);
@@ -150,6 +154,7 @@ public:
      */
     std::vector<std::string> sections()
     {
+        midll::detail::observed_phase phase("library_info", path_);
         switch (fmt_) {
             case fmt_elf_info32:
                 return midll::detail::elf_info32::sections(f_);
@@ -172,6 +177,7 @@ public:
      */
     std::vector<std::string> symbols()
     {
+        midll::detail::observed_phase phase("library_info", path_);
         switch (fmt_) {
             case fmt_elf_info32:
                 return midll::detail::elf_info32::symbols(f_);
@@ -195,6 +201,7 @@ public:
      */
     std::vector<std::string> symbols(const char* section_name)
     {
+        midll::detail::observed_phase phase("library_info", path_);
         switch (fmt_) {
             case fmt_elf_info32:
                 return midll::detail::elf_info32::symbols(f_, section_name);
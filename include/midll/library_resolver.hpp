@@ -0,0 +1,255 @@
+// Copyright Antony Polukhin, 2015-2024.
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <midll/config.hpp>
+#include <midll/detail/system_error.hpp>
+#include <midll/shared_library.hpp>
+
+/// \file midll/library_resolver.hpp
+/// \brief Contains only the midll::library_resolver class that resolves library names over a search path.
+
+namespace midll
+{
+
+/*!
+ * \brief Resolves short library names to paths over a list of search roots without touching the filesystem
+ * for each query.
+ *
+ * The resolver takes a snapshot of the directory listings of the roots and resolves names in memory: for the name
+ * "plugin" it looks for the decorated file name ("libplugin.so" on Linux, "plugin.dll" on Windows) and then for
+ * "plugin" itself, in each root in order. The first root that contains any of the candidates wins.
+ *
+ * The snapshot is the authority: a name missing from it is reported as missing without touching the filesystem.
+ * Once the snapshot is older than the `ttl` passed to the constructor, the next miss retakes it, so libraries that
+ * appeared after the snapshot was taken are found within the `ttl`. Resolving any count of missing names costs at
+ * most one rescan of the roots per `ttl`.
+ *
+ * Files removed after the snapshot was taken are still reported, call refresh() to retake the snapshot.
+ *
+ * All the member functions are thread safe.
+ *
+ * \b Example:
+ * \code
+ * midll::library_resolver resolver({"/opt/app/plugins", "/usr/lib/app/plugins"});
+ * for (const std::string& name : plugin_names) {
+ *     midll::fs::error_code ec;
+ *     midll::shared_library lib = resolver.load(name, ec);
+ * }
+ * \endcode
+ */
+class library_resolver
+{
+public:
+    using clock = std::chrono::steady_clock;
+
+private:
+    std::vector<midll::fs::path> roots_;
+    clock::duration ttl_;
+
+    struct file_entry
+    {
+        midll::fs::path path;
+        std::size_t root;
+    };
+
+    using files_map = std::unordered_map<midll::fs::path::string_type, file_entry>;
+
+    mutable std::mutex mutex_;
+    files_map files_;
+    clock::time_point scanned_at_;
+
+    // Does not touch the members except for the constant roots_, so could be called without the lock
+    files_map scan() const
+    {
+        files_map files;
+        for (std::size_t root = 0; root < roots_.size(); ++root) {
+            midll::detail::observed_phase phase("directory_scan", roots_[root]);
+            midll::fs::error_code ec;
+            midll::fs::directory_iterator it(roots_[root], ec);
+            for (; !ec && it != midll::fs::directory_iterator(); it.increment(ec)) {
+                midll::fs::error_code ignore;
+                if (it->is_directory(ignore)) {
+                    continue;
+                }
+
+                // First root that has the file wins
+                files.emplace(it->path().filename().native(), file_entry{it->path(), root});
+            }
+        }
+        return files;
+    }
+
+    std::vector<midll::fs::path> candidates(const midll::fs::path& name) const
+    {
+        std::vector<midll::fs::path> result;
+        result.push_back(shared_library::decorate(name).filename());
+        if (result.front() != name) {
+            result.push_back(name);
+        }
+        return result;
+    }
+
+    // Must be called under the lock
+    const midll::fs::path* find_in_snapshot(const std::vector<midll::fs::path>& names) const
+    {
+        // Roots order is more important than the candidates order
+        const file_entry* best = nullptr;
+        for (const midll::fs::path& n : names) {
+            const auto it = files_.find(n.native());
+            if (it != files_.end() && (!best || it->second.root < best->root)) {
+                best = &it->second;
+            }
+        }
+        return (best ? &best->path : nullptr);
+    }
+
+public:
+    /*!
+     * Takes a snapshot of the directory listings of the `roots`. Missing or unreadable roots are ignored.
+     *
+     * \param roots Directories to search in, in the order of priority.
+     * \param ttl Age of the snapshot after which a miss retakes it.
+     * \throw std::bad_alloc in case of insufficient memory.
+     */
+    explicit library_resolver(std::vector<midll::fs::path> roots, clock::duration ttl = std::chrono::seconds(5))
+        : roots_(std::move(roots))
+        , ttl_(ttl)
+        , files_(scan())
+        , scanned_at_(clock::now())
+    {
+    }
+
+    library_resolver(const library_resolver&) = delete;
+    library_resolver& operator=(const library_resolver&) = delete;
+
+    /*!
+     * Retakes the snapshot of the directory listings.
+     *
+     * \throw std::bad_alloc in case of insufficient memory.
+     */
+    void refresh()
+    {
+        const clock::time_point now = clock::now();
+        files_map files = scan();
+        std::lock_guard<std::mutex> lock(mutex_);
+        files_.swap(files);
+        scanned_at_ = now;
+    }
+
+    /*!
+     * Resolves a library name to a path in one of the roots.
+     *
+     * \param name Library name without a parent path, with or without decorations. Names with a parent path are
+     *           returned as is.
+     * \param ec Variable that will be set to the result of the operation: `no_such_file_or_directory` if the
+     *           library was not found in any of the roots.
+     * \return Path to the library or an empty path if it was not found.
+     * \throw std::bad_alloc in case of insufficient memory. Overload that does not accept \forcedlinkfs{error_code}
+     * also throws \forcedlinkfs{system_error}.
+     */
+    midll::fs::path resolve(const midll::fs::path& name, midll::fs::error_code& ec)
+    {
+        ec.clear();
+        if (name.has_parent_path()) {
+            return name;
+        }
+
+        const std::vector<midll::fs::path> names = candidates(name);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (const midll::fs::path* p = find_in_snapshot(names)) {
+                return *p;
+            }
+
+            const clock::time_point now = clock::now();
+            if (now - scanned_at_ < ttl_) {
+                ec = midll::fs::make_error_code(midll::fs::errc::no_such_file_or_directory);
+                return {};
+            }
+
+            // Claiming the rescan, concurrent misses keep using the current snapshot
+            scanned_at_ = now;
+        }
+
+        // Scanning without the lock, the filesystem could be slow
+        files_map files = scan();
+        std::lock_guard<std::mutex> lock(mutex_);
+        files_.swap(files);
+        if (const midll::fs::path* p = find_in_snapshot(names)) {
+            return *p;
+        }
+
+        ec = midll::fs::make_error_code(midll::fs::errc::no_such_file_or_directory);
+        return {};
+    }
+
+    //! \overload midll::fs::path resolve(const midll::fs::path& name, midll::fs::error_code& ec)
+    midll::fs::path resolve(const midll::fs::path& name)
+    {
+        midll::fs::error_code ec;
+        midll::fs::path p = resolve(name, ec);
+        if (ec) {
+            midll::detail::report_error(ec, "midll::library_resolver::resolve() failed");
+        }
+
+        return p;
+    }
+
+    /*!
+     * Resolves a library name and loads the library by the resolved path.
+     *
+     * \param name Library name, see resolve().
+     * \param ec Variable that will be set to the result of the operation.
+     * \param mode A mode that will be used on library load. `append_decorations` and `search_system_folders`
+     *           are ignored.
+     * \return Loaded library or an empty shared_library in case of error.
+     * \throw std::bad_alloc in case of insufficient memory. Overload that does not accept \forcedlinkfs{error_code}
+     * also throws \forcedlinkfs{system_error}.
+     */
+    shared_library load(const midll::fs::path& name, midll::fs::error_code& ec,
+                        load_mode::type mode = load_mode::default_mode)
+    {
+        const midll::fs::path p = resolve(name, ec);
+        if (ec) {
+            return shared_library();
+        }
+
+        return shared_library(p, ec, mode & ~(load_mode::append_decorations | load_mode::search_system_folders));
+    }
+
+    //! \overload shared_library load(const midll::fs::path& name, midll::fs::error_code& ec, load_mode::type mode)
+    shared_library load(const midll::fs::path& name, load_mode::type mode = load_mode::default_mode)
+    {
+        midll::fs::error_code ec;
+        shared_library lib = load(name, ec, mode);
+        if (ec) {
+            midll::detail::report_error(ec, "midll::library_resolver::load() failed");
+        }
+
+        return lib;
+    }
+
+    /// \return Search roots in the order of priority.
+    const std::vector<midll::fs::path>& roots() const noexcept { return roots_; }
+
+    /// \return Count of the files in the snapshot.
+    std::size_t size() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return files_.size();
+    }
+};
+
+} // namespace midll
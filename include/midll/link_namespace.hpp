@@ -0,0 +1,57 @@
+// Copyright Antony Polukhin, 2015-2024.
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <midll/config.hpp>
+
+#include <cstddef>
+
+/// \file midll/link_namespace.hpp
+/// \brief Contains only the midll::link_namespace class that identifies a dynamic linker namespace.
+
+namespace midll
+{
+
+/*!
+ * \brief Identifier of a dynamic linker namespace (`Lmid_t` of glibc).
+ *
+ * Each namespace has its own copy of every library loaded into it, including the copies of global variables.
+ * Libraries are loaded into a namespace other than the base one via `dlmopen`, which is supported only by glibc.
+ * On other platforms only the base namespace is available.
+ */
+class link_namespace
+{
+    long id_;
+
+public:
+    /*!
+     * Wraps an existing namespace identifier, for example the one returned by `dlinfo(handle, RTLD_DI_LMID, &id)`.
+     *
+     * \throw Nothing.
+     */
+    constexpr explicit link_namespace(long id) noexcept
+        : id_(id)
+    {
+    }
+
+    /// \return The namespace of the main program and of the libraries loaded with `dlopen` (`LM_ID_BASE`).
+    static constexpr link_namespace base() noexcept { return link_namespace(0); }
+
+    /// \return Identifier that requests a new namespace for the library being loaded (`LM_ID_NEWLM`).
+    static constexpr link_namespace create_new() noexcept { return link_namespace(-1); }
+
+    /// \return The native namespace identifier.
+    constexpr long id() const noexcept { return id_; }
+
+    constexpr bool operator==(link_namespace rhs) const noexcept { return id_ == rhs.id_; }
+    constexpr bool operator!=(link_namespace rhs) const noexcept { return id_ != rhs.id_; }
+};
+
+/// Maximal count of the namespaces in process, including the base one (`DL_NNS` of glibc).
+constexpr std::size_t max_link_namespaces = 16;
+
+} // namespace midll
@@ -0,0 +1,245 @@
+// Copyright Antony Polukhin, 2015-2024.
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <string>
+#include <vector>
+
+#include <midll/config.hpp>
+#include <midll/detail/system_error.hpp>
+
+#ifndef MIDLL_OS_WINDOWS
+#    include <midll/detail/posix/program_headers.hpp>
+#    include <midll/detail/posix/program_location_impl.hpp>
+#endif
+
+/// \file midll/loaded_modules.hpp
+/// \brief Contains the midll::loaded_modules() function that enumerates all the binaries loaded into the process.
+
+namespace midll
+{
+
+/*!
+ * \brief Address range of a segment of a loaded binary.
+ */
+struct module_segment
+{
+    static constexpr unsigned executable = 1; ///< Segment contains code (PF_X)
+    static constexpr unsigned writable = 2;   ///< Segment contains writable data (PF_W)
+    static constexpr unsigned readable = 4;   ///< Segment is readable (PF_R)
+
+    std::uintptr_t begin; ///< Address of the first byte of the segment
+    std::uintptr_t end;   ///< Address of the byte after the last byte of the segment
+    unsigned flags;       ///< Combination of executable, writable and readable flags
+
+    /// \return true if `ptr` points into the segment.
+    bool contains(const void* ptr) const noexcept
+    {
+        const std::uintptr_t p = reinterpret_cast<std::uintptr_t>(ptr);
+        return begin <= p && p < end;
+    }
+};
+
+/*!
+ * \brief Description of a binary loaded into the process. Segments of the binary are stored in the
+ * loaded_modules_snapshot, see loaded_modules_snapshot::segments_begin().
+ */
+struct loaded_module
+{
+    std::string name;           ///< Path of the binary, \forcedlink{program_location} for the main program
+    std::uintptr_t base;        ///< Load bias: difference between the actual and the linked addresses
+    std::size_t tls_module_id;  ///< TLS module id of the binary or 0 if the binary has no TLS
+    std::size_t first_segment;  ///< Index of the first segment in loaded_modules_snapshot::segments()
+    std::size_t segments_count; ///< Count of the PT_LOAD segments of the binary
+};
+
+/*!
+ * \brief Snapshot of all the binaries loaded into the process, sorted by the address of their first segment.
+ *
+ * Snapshot is not updated when libraries are loaded or unloaded, use is_stale() to check if it should be retaken.
+ */
+class loaded_modules_snapshot
+{
+    std::vector<loaded_module> modules_;
+    std::vector<module_segment> segments_;
+    std::uint64_t generation_ = 0;
+
+    /// @cond
+    friend loaded_modules_snapshot loaded_modules(midll::fs::error_code& ec);
+    /// @endcond
+
+public:
+    /// \return All the loaded binaries sorted by the address of their first segment.
+    const std::vector<loaded_module>& modules() const noexcept { return modules_; }
+
+    /// \return Segments of all the binaries, segments of each binary are stored contiguously.
+    const std::vector<module_segment>& segments() const noexcept { return segments_; }
+
+    /// \return Pointer to the first segment of the binary `m`.
+    const module_segment* segments_begin(const loaded_module& m) const noexcept
+    {
+        return segments_.data() + m.first_segment;
+    }
+
+    /// \return Pointer to the segment after the last segment of the binary `m`.
+    const module_segment* segments_end(const loaded_module& m) const noexcept
+    {
+        return segments_.data() + m.first_segment + m.segments_count;
+    }
+
+    /// \return Value of loaded_modules_generation() at the moment the snapshot was taken.
+    std::uint64_t generation() const noexcept { return generation_; }
+
+    /// \return true if any binary was loaded or unloaded since the snapshot was taken.
+    inline bool is_stale() const noexcept;
+};
+
+/*!
+ * Returns a counter that changes each time a binary is loaded into the process or unloaded from it.
+ * The call is cheap and does not allocate, so it could be used to check that a cached loaded_modules() snapshot
+ * is still valid.
+ *
+ * \return Sum of `dlpi_adds` and `dlpi_subs` counters of the dynamic linker, 0 if not supported by the platform.
+ * \throw Nothing.
+ */
+inline std::uint64_t loaded_modules_generation() noexcept
+{
+#ifdef MIDLL_HAS_PROGRAM_HEADERS
+    std::uint64_t generation = 0;
+    dl_iterate_phdr(
+        [](struct dl_phdr_info* info, std::size_t size, void* data) -> int {
+            if (size >= offsetof(struct dl_phdr_info, dlpi_subs) + sizeof(info->dlpi_subs)) {
+                *static_cast<std::uint64_t*>(data) = static_cast<std::uint64_t>(info->dlpi_adds + info->dlpi_subs);
+            }
+            return 1;
+        },
+        &generation);
+    return generation;
+#else
+    return 0;
+#endif
+}
+
+inline bool loaded_modules_snapshot::is_stale() const noexcept
+{
+    return generation_ != midll::loaded_modules_generation();
+}
+
+/*!
+ * Takes a snapshot of all the binaries loaded into the process in a single pass over the dynamic linker
+ * structures.
+ *
+ * \b Example:
+ * \code
+ * midll::loaded_modules_snapshot snapshot = midll::loaded_modules();
+ * for (const midll::loaded_module& m : snapshot.modules()) {
+ *     std::cout << m.name << '\n';
+ * }
+ * \endcode
+ *
+ * \param ec Variable that will be set to the result of the operation.
+ * \return Snapshot of the loaded binaries.
+ * \throw std::bad_alloc in case of insufficient memory. Overload that does not accept \forcedlinkfs{error_code} also
+ * throws \forcedlinkfs{system_error}.
+ */
+inline loaded_modules_snapshot loaded_modules(midll::fs::error_code& ec)
+{
+    ec.clear();
+    loaded_modules_snapshot snapshot;
+
+#ifdef MIDLL_HAS_PROGRAM_HEADERS
+    struct context_t
+    {
+        loaded_modules_snapshot* snapshot;
+        std::exception_ptr error;
+    } context = {&snapshot, nullptr};
+
+    snapshot.modules_.reserve(64);
+    snapshot.segments_.reserve(64 * 4);
+    dl_iterate_phdr(
+        [](struct dl_phdr_info* info, std::size_t size, void* data) -> int {
+            context_t& ctx = *static_cast<context_t*>(data);
+            loaded_modules_snapshot& s = *ctx.snapshot;
+            if (s.modules_.empty() && size >= offsetof(struct dl_phdr_info, dlpi_subs) + sizeof(info->dlpi_subs)) {
+                s.generation_ = static_cast<std::uint64_t>(info->dlpi_adds + info->dlpi_subs);
+            }
+
+            // Exceptions must not propagate through the `dl_iterate_phdr` that holds the loader lock
+            try {
+                loaded_module m{info->dlpi_name ? info->dlpi_name : "", static_cast<std::uintptr_t>(info->dlpi_addr),
+                                static_cast<std::size_t>(info->dlpi_tls_modid), s.segments_.size(), 0};
+
+                for (ElfW(Half) i = 0; i < info->dlpi_phnum; ++i) {
+                    const ElfW(Phdr)& phdr = info->dlpi_phdr[i];
+                    if (phdr.p_type != PT_LOAD) {
+                        continue;
+                    }
+
+                    const std::uintptr_t begin = static_cast<std::uintptr_t>(info->dlpi_addr + phdr.p_vaddr);
+                    s.segments_.push_back(module_segment{begin, begin + static_cast<std::uintptr_t>(phdr.p_memsz),
+                                                         static_cast<unsigned>(phdr.p_flags & (PF_X | PF_W | PF_R))});
+                    ++m.segments_count;
+                }
+
+                s.modules_.push_back(std::move(m));
+            }
+            catch (...) {
+                ctx.error = std::current_exception();
+                return 1;
+            }
+            return 0;
+        },
+        &context);
+
+    if (context.error) {
+        std::rethrow_exception(context.error);
+    }
+
+    for (loaded_module& m : snapshot.modules_) {
+        std::sort(snapshot.segments_.begin() + static_cast<std::ptrdiff_t>(m.first_segment),
+                  snapshot.segments_.begin() + static_cast<std::ptrdiff_t>(m.first_segment + m.segments_count),
+                  [](const module_segment& l, const module_segment& r) { return l.begin < r.begin; });
+
+        if (m.name.empty()) {
+            // The main program has no name in the dynamic linker structures
+            midll::fs::error_code ignore;
+            m.name = midll::detail::program_location_impl(ignore).string();
+        }
+    }
+
+    const auto first_address = [&snapshot](const loaded_module& m) {
+        return m.segments_count ? snapshot.segments_[m.first_segment].begin : m.base;
+    };
+    std::sort(snapshot.modules_.begin(), snapshot.modules_.end(),
+              [&first_address](const loaded_module& l, const loaded_module& r) {
+                  return first_address(l) < first_address(r);
+              });
+#else
+    ec = midll::fs::make_error_code(midll::fs::errc::operation_not_supported);
+#endif
+
+    return snapshot;
+}
+
+//! \overload loaded_modules(midll::fs::error_code& ec)
+inline loaded_modules_snapshot loaded_modules()
+{
+    midll::fs::error_code ec;
+    loaded_modules_snapshot snapshot = midll::loaded_modules(ec);
+
+    if (ec) {
+        midll::detail::report_error(ec, "midll::loaded_modules() failed");
+    }
+
+    return snapshot;
+}
+
+} // namespace midll
@@ -0,0 +1,165 @@
+// Copyright Antony Polukhin, 2015-2024.
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+
+#include <midll/config.hpp>
+#include <midll/detail/system_error.hpp>
+#include <midll/shared_library_load_mode.hpp>
+
+/// \file midll/loader_observer.hpp
+/// \brief Contains the midll::loader_observer interface and functions to install a process wide observer of the
+/// library loads, symbol lookups and unloads.
+
+namespace midll
+{
+
+/// Clock used for the timings of the loader events.
+using loader_clock = std::chrono::steady_clock;
+
+/*!
+ * \brief Library load performed by midll::shared_library.
+ */
+struct load_event
+{
+    const midll::fs::path& requested_path; ///< Path passed to shared_library::load()
+    const midll::fs::path& resolved_path;  ///< Path of the loaded library, empty if the load failed
+    load_mode::type mode;                  ///< Mode passed to shared_library::load()
+    const midll::fs::error_code& ec;       ///< Result of the load
+    void* native_handle;                   ///< Handle of the loaded library or nullptr
+    loader_clock::time_point start;        ///< Time when the load started
+    loader_clock::duration duration;       ///< Duration of the load
+};
+
+/*!
+ * \brief Symbol lookup performed by shared_library::get(), shared_library::try_get() or shared_library::has().
+ */
+struct symbol_event
+{
+    const char* name;                ///< Name of the symbol
+    void* native_handle;             ///< Handle of the library
+    bool found;                      ///< true if the symbol was found
+    loader_clock::time_point start;  ///< Time when the lookup started
+    loader_clock::duration duration; ///< Duration of the lookup
+};
+
+/*!
+ * \brief Library unload performed by shared_library::unload() or by the shared_library destructor.
+ */
+struct unload_event
+{
+    void* native_handle;             ///< Handle of the unloaded library
+    loader_clock::time_point start;  ///< Time when the unload started
+    loader_clock::duration duration; ///< Duration of the unload, see load_mode::deferred_unload
+};
+
+/*!
+ * \brief Internal step of a midll operation.
+ *
+ * Names of the phases:
+ * - "resolve_path": fixing up the path before the load.
+ * - "open": `dlopen` or `LoadLibraryExW` call, there could be several of them per load.
+ * - "huge_text": remapping of the code onto huge pages, see load_mode::huge_text.
+ * - "mlock": locking of the library in memory, see load_mode::mlock.
+ * - "prefault": faulting in the pages of the library after the load, see load_mode::prefault.
+ * - "directory_scan": listing of a search root by midll::library_resolver.
+ * - "library_info": parsing of a binary by midll::library_info.
+ * - "prefetch": reading a library into the page cache by midll::replay_manifest().
+ * - "bind": resolving a batch of symbols.
+ */
+struct phase_event
+{
+    const char* name;                ///< Name of the phase
+    const midll::fs::path& subject;  ///< Library or directory the phase works with
+    loader_clock::time_point start;  ///< Time when the phase started
+    loader_clock::duration duration; ///< Duration of the phase
+};
+
+/*!
+ * \brief Interface of the observer of the loader events, see midll::set_loader_observer().
+ *
+ * Callbacks are called synchronously on the thread that performs the operation, so they must be fast and thread
+ * safe. See midll::buffered_loader_observer for an observer that only stores events into per thread buffers.
+ */
+class loader_observer
+{
+public:
+    virtual void on_load(const load_event& /*e*/) noexcept {}
+    virtual void on_symbol(const symbol_event& /*e*/) noexcept {}
+    virtual void on_unload(const unload_event& /*e*/) noexcept {}
+    virtual void on_phase(const phase_event& /*e*/) noexcept {}
+
+    virtual ~loader_observer() = default;
+};
+
+/// @cond
+namespace detail
+{
+inline std::atomic<loader_observer*> g_loader_observer{nullptr};
+
+inline loader_observer* current_loader_observer() noexcept
+{
+    return g_loader_observer.load(std::memory_order_acquire);
+}
+
+// Reports the lifetime of the scope as a phase_event if an observer is installed.
+class observed_phase
+{
+    loader_observer* const observer_;
+    const char* const name_;
+    const midll::fs::path& subject_;
+    loader_clock::time_point start_;
+
+public:
+    observed_phase(const char* name, const midll::fs::path& subject) noexcept
+        : observer_(current_loader_observer())
+        , name_(name)
+        , subject_(subject)
+    {
+        if (observer_) {
+            start_ = loader_clock::now();
+        }
+    }
+
+    observed_phase(const observed_phase&) = delete;
+    observed_phase& operator=(const observed_phase&) = delete;
+
+    ~observed_phase()
+    {
+        if (observer_) {
+            observer_->on_phase(phase_event{name_, subject_, start_, loader_clock::now() - start_});
+        }
+    }
+};
+} // namespace detail
+/// @endcond
+
+/*!
+ * Installs the process wide observer of the loader events. Without an observer the instrumentation costs a single
+ * atomic load per operation.
+ *
+ * The observer must stay alive while any thread could call midll functions, including the time after it was replaced
+ * by another observer.
+ *
+ * \param observer New observer or nullptr to disable the notifications.
+ * \return Previous observer.
+ * \throw Nothing.
+ */
+inline loader_observer* set_loader_observer(loader_observer* observer) noexcept
+{
+    return midll::detail::g_loader_observer.exchange(observer, std::memory_order_acq_rel);
+}
+
+/// \return Currently installed observer or nullptr.
+inline loader_observer* get_loader_observer() noexcept
+{
+    return midll::detail::current_loader_observer();
+}
+
+} // namespace midll
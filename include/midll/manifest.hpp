@@ -0,0 +1,451 @@
+// Copyright Antony Polukhin, 2015-2024.
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <midll/config.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdlib>
+#include <fstream>
+#include <istream>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#ifndef MIDLL_OS_WINDOWS
+#    include <fcntl.h>
+#    include <unistd.h>
+#endif
+
+#include <midll/detail/system_error.hpp>
+#include <midll/loader_observer.hpp>
+#include <midll/shared_library.hpp>
+
+/// \file midll/manifest.hpp
+/// \brief Contains the midll::manifest_recorder class that records the libraries loaded by the process and the
+/// midll::replay_manifest() function that loads them ahead of time on the next start.
+
+namespace midll
+{
+
+/*!
+ * \brief Library recorded in a manifest, see midll::manifest_recorder.
+ */
+struct manifest_entry
+{
+    midll::fs::path path;             ///< Resolved path of the library
+    load_mode::type mode;             ///< Mode of the load without `append_decorations` and `search_system_folders`
+    std::vector<std::string> symbols; ///< Symbols that were found in the library, in the order of the first lookup
+};
+
+/*!
+ * \brief Observer that records the libraries loaded via midll::shared_library, in the order of their first load,
+ * along with the load modes and the symbols that were looked up in them.
+ *
+ * Manifest is a text file with a "midll-manifest 1" header followed by a "load <mode> <path>" line for each library
+ * and a "symbol <name>" line for each of its symbols. Modes are platform specific, so manifests are not portable
+ * between platforms. Loads into non base linker namespaces are recorded as loads into the base namespace.
+ *
+ * \b Example:
+ * \code
+ * midll::manifest_recorder recorder;
+ * midll::set_loader_observer(&recorder);
+ * load_all_plugins();
+ * midll::set_loader_observer(nullptr);
+ * recorder.write("plugins.manifest");
+ * \endcode
+ */
+class manifest_recorder : public loader_observer
+{
+    struct library
+    {
+        manifest_entry entry;
+        void* handle;
+    };
+
+    mutable std::mutex mutex_;
+    std::vector<library> libraries_;
+
+public:
+    manifest_recorder() = default;
+    manifest_recorder(const manifest_recorder&) = delete;
+    manifest_recorder& operator=(const manifest_recorder&) = delete;
+
+    void on_load(const load_event& e) noexcept override
+    {
+        if (e.ec || !e.native_handle || e.resolved_path.empty()) {
+            return;
+        }
+
+        try {
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (library& l : libraries_) {
+                if (l.entry.path == e.resolved_path) {
+                    l.handle = e.native_handle;
+                    return;
+                }
+            }
+
+            // Recorded path is the resolved one, so the decorations and the search must not be applied on replay
+            const load_mode::type mode = e.mode & ~(load_mode::append_decorations | load_mode::search_system_folders);
+            libraries_.push_back(library{manifest_entry{e.resolved_path, mode, {}}, e.native_handle});
+        }
+        catch (...) {
+            // Out of memory, the library is not recorded
+        }
+    }
+
+    void on_symbol(const symbol_event& e) noexcept override
+    {
+        if (!e.found || !e.name) {
+            return;
+        }
+
+        try {
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (auto it = libraries_.rbegin(); it != libraries_.rend(); ++it) {
+                if (it->handle != e.native_handle) {
+                    continue;
+                }
+
+                std::vector<std::string>& symbols = it->entry.symbols;
+                if (std::find(symbols.begin(), symbols.end(), e.name) == symbols.end()) {
+                    symbols.emplace_back(e.name);
+                }
+                return;
+            }
+        }
+        catch (...) {
+            // Out of memory, the symbol is not recorded
+        }
+    }
+
+    /*!
+     * \return Recorded libraries in the order of their first load.
+     * \throw std::bad_alloc in case of insufficient memory.
+     */
+    std::vector<manifest_entry> entries() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::vector<manifest_entry> result;
+        result.reserve(libraries_.size());
+        for (const library& l : libraries_) {
+            result.push_back(l.entry);
+        }
+        return result;
+    }
+
+    /*!
+     * Writes the manifest into the stream.
+     *
+     * \throw Whatever the stream throws, std::bad_alloc in case of insufficient memory.
+     */
+    void write(std::ostream& out) const
+    {
+        out << "midll-manifest 1\n";
+        for (const manifest_entry& e : entries()) {
+            out << "load " << static_cast<unsigned int>(e.mode) << ' ' << e.path.string() << '\n';
+            for (const std::string& s : e.symbols) {
+                out << "symbol " << s << '\n';
+            }
+        }
+    }
+
+    /*!
+     * Writes the manifest into the file, replacing its content.
+     *
+     * \param manifest_path Path of the manifest.
+     * \param ec Variable that will be set to the result of the operation.
+     * \throw std::bad_alloc in case of insufficient memory. Overload that does not accept \forcedlinkfs{error_code}
+     * also throws \forcedlinkfs{system_error}.
+     */
+    void write(const midll::fs::path& manifest_path, midll::fs::error_code& ec) const
+    {
+        ec.clear();
+        errno = 0;
+        std::ofstream out(manifest_path, std::ios_base::out | std::ios_base::trunc);
+        if (out) {
+            write(out);
+            out.flush();
+        }
+        if (!out) {
+            ec = (errno ? midll::fs::error_code(errno, std::generic_category())
+                        : midll::fs::make_error_code(midll::fs::errc::io_error));
+        }
+    }
+
+    //! \overload void write(const midll::fs::path& manifest_path, midll::fs::error_code& ec) const
+    void write(const midll::fs::path& manifest_path) const
+    {
+        midll::fs::error_code ec;
+        write(manifest_path, ec);
+        if (ec) {
+            throw midll::fs::system_error(ec, "midll::manifest_recorder::write() failed");
+        }
+    }
+};
+
+/*!
+ * Reads a manifest written by midll::manifest_recorder.
+ *
+ * \param manifest_path Path of the manifest.
+ * \param ec Variable that will be set to the result of the operation, `errc::invalid_argument` if the file is not
+ * a manifest.
+ * \return Recorded libraries in the order of their first load.
+ * \throw std::bad_alloc in case of insufficient memory. Overload that does not accept \forcedlinkfs{error_code} also
+ * throws \forcedlinkfs{system_error}.
+ */
+inline std::vector<manifest_entry> read_manifest(const midll::fs::path& manifest_path, midll::fs::error_code& ec)
+{
+    ec.clear();
+    std::vector<manifest_entry> result;
+
+    errno = 0;
+    std::ifstream in(manifest_path);
+    if (!in) {
+        ec = (errno ? midll::fs::error_code(errno, std::generic_category())
+                    : midll::fs::make_error_code(midll::fs::errc::no_such_file_or_directory));
+        return result;
+    }
+
+    std::string line;
+    if (!std::getline(in, line) || line != "midll-manifest 1") {
+        ec = midll::fs::make_error_code(midll::fs::errc::invalid_argument);
+        return result;
+    }
+
+    while (std::getline(in, line)) {
+        if (line.compare(0, 5, "load ") == 0) {
+            char* path_begin = nullptr;
+            const unsigned long mode = std::strtoul(line.c_str() + 5, &path_begin, 10);
+            if (*path_begin != ' ' || !path_begin[1]) {
+                ec = midll::fs::make_error_code(midll::fs::errc::invalid_argument);
+                result.clear();
+                return result;
+            }
+            result.push_back(manifest_entry{midll::fs::path(path_begin + 1), static_cast<load_mode::type>(mode), {}});
+        }
+        else if (line.compare(0, 7, "symbol ") == 0 && !result.empty()) {
+            result.back().symbols.push_back(line.substr(7));
+        }
+        else if (!line.empty()) {
+            ec = midll::fs::make_error_code(midll::fs::errc::invalid_argument);
+            result.clear();
+            return result;
+        }
+    }
+
+    return result;
+}
+
+//! \overload read_manifest(const midll::fs::path& manifest_path, midll::fs::error_code& ec)
+inline std::vector<manifest_entry> read_manifest(const midll::fs::path& manifest_path)
+{
+    midll::fs::error_code ec;
+    std::vector<manifest_entry> result = midll::read_manifest(manifest_path, ec);
+    if (ec) {
+        midll::detail::report_error(ec, "midll::read_manifest() failed");
+    }
+    return result;
+}
+
+/*!
+ * \brief Settings of midll::replay_manifest().
+ */
+struct replay_options
+{
+    /// Count of the threads that load the libraries, 0 for `std::thread::hardware_concurrency()`.
+    unsigned threads = 0;
+
+    /// Ask the OS to read all the libraries into the page cache before loading them.
+    bool prefetch = true;
+
+    /// Look up the recorded symbols right after the load, so that the pages with the symbol tables are faulted in.
+    bool lookup_symbols = true;
+};
+
+/// @cond
+namespace detail
+{
+
+inline void prefetch_file(const midll::fs::path& p) noexcept
+{
+#if defined(MIDLL_OS_LINUX) || defined(MIDLL_OS_ANDROID) || defined(MIDLL_OS_FREEBSD)
+    midll::detail::observed_phase phase("prefetch", p);
+    const int fd = ::open(p.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd >= 0) {
+        // Starts an asynchronous read of the whole file into the page cache
+        (void)::posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+        ::close(fd);
+    }
+#else
+    (void)p;
+#endif
+}
+
+// Joins the started threads on every exit path, destroying a joinable std::thread calls std::terminate()
+struct thread_joiner
+{
+    std::vector<std::thread>& threads;
+
+    ~thread_joiner()
+    {
+        for (std::thread& t : threads) {
+            t.join();
+        }
+    }
+};
+
+} // namespace detail
+/// @endcond
+
+/*!
+ * Loads the libraries recorded by midll::manifest_recorder on a pool of threads, so that the following loads of
+ * the same libraries by the application only take a reference to the already loaded ones.
+ *
+ * All the files are prefetched into the page cache first. Libraries are loaded concurrently in batches: a library
+ * loaded with `load_mode::rtld_global` could provide symbols for the libraries recorded after it, so it is loaded
+ * alone after all the preceding libraries and before all the following ones. Dependencies from DT_NEEDED are
+ * loaded by the dynamic linker itself.
+ *
+ * \b Example:
+ * \code
+ * // Keep the libraries loaded until the application takes its own references
+ * std::vector<midll::shared_library> warm = midll::replay_manifest(midll::read_manifest("plugins.manifest"));
+ * \endcode
+ *
+ * \param entries Libraries to load, usually from midll::read_manifest().
+ * \param ec Variable that will be set to the error of the first library that failed to load, other libraries are
+ * loaded anyway.
+ * \param options Settings of the replay.
+ * \return Loaded libraries in the order of `entries`, instances for the libraries that failed to load are empty.
+ * \throw std::bad_alloc in case of insufficient memory. Overload that does not accept \forcedlinkfs{error_code} also
+ * throws \forcedlinkfs{system_error}.
+ */
+inline std::vector<shared_library> replay_manifest(const std::vector<manifest_entry>& entries,
+                                                   midll::fs::error_code& ec, const replay_options& options = {})
+{
+    ec.clear();
+    std::vector<shared_library> result(entries.size());
+    std::vector<midll::fs::error_code> errors(entries.size());
+
+    if (options.prefetch) {
+        for (const manifest_entry& e : entries) {
+            midll::detail::prefetch_file(e.path);
+        }
+    }
+
+    const auto load_one = [&](std::size_t i) {
+        const manifest_entry& e = entries[i];
+        result[i].load(e.path, e.mode, errors[i]);
+        if (!errors[i] && options.lookup_symbols) {
+            for (const std::string& s : e.symbols) {
+                (void)result[i].has(s);
+            }
+        }
+    };
+
+    unsigned threads = (options.threads ? options.threads : std::thread::hardware_concurrency());
+    threads = (threads ? threads : 1);
+
+    for (std::size_t begin = 0; begin < entries.size();) {
+        if (!!(entries[begin].mode & load_mode::rtld_global)) {
+            load_one(begin);
+            ++begin;
+            continue;
+        }
+
+        std::size_t end = begin + 1;
+        while (end < entries.size() && !(entries[end].mode & load_mode::rtld_global)) {
+            ++end;
+        }
+
+        std::atomic<std::size_t> next{begin};
+        const auto worker = [&]() {
+            for (std::size_t i = next++; i < end; i = next++) {
+                load_one(i);
+            }
+        };
+
+        std::vector<std::thread> pool;
+        const std::size_t extra = (std::min)(static_cast<std::size_t>(threads), end - begin) - 1;
+        {
+            const midll::detail::thread_joiner joiner{pool};
+            try {
+                for (std::size_t t = 0; t < extra; ++t) {
+                    pool.emplace_back(worker);
+                }
+            }
+            catch (const std::system_error&) {
+                // No more threads, loading with the threads that were started
+            }
+            worker();
+        }
+
+        begin = end;
+    }
+
+    for (const midll::fs::error_code& e : errors) {
+        if (e) {
+            ec = e;
+            break;
+        }
+    }
+    return result;
+}
+
+//! \overload replay_manifest(const std::vector<manifest_entry>&, midll::fs::error_code&, const replay_options&)
+inline std::vector<shared_library> replay_manifest(const std::vector<manifest_entry>& entries,
+                                                   const replay_options& options = {})
+{
+    midll::fs::error_code ec;
+    std::vector<shared_library> result = midll::replay_manifest(entries, ec, options);
+    if (ec) {
+        midll::detail::report_error(ec, "midll::replay_manifest() failed");
+    }
+    return result;
+}
+
+/*!
+ * Reads the manifest with midll::read_manifest() and loads the libraries with midll::replay_manifest().
+ *
+ * \param manifest_path Path of the manifest.
+ * \param ec Variable that will be set to the result of the operation.
+ * \param options Settings of the replay.
+ * \return Loaded libraries in the order of the manifest, instances for the libraries that failed to load are empty.
+ * \throw std::bad_alloc in case of insufficient memory. Overload that does not accept \forcedlinkfs{error_code} also
+ * throws \forcedlinkfs{system_error}.
+ */
+inline std::vector<shared_library> replay_manifest(const midll::fs::path& manifest_path, midll::fs::error_code& ec,
+                                                   const replay_options& options = {})
+{
+    const std::vector<manifest_entry> entries = midll::read_manifest(manifest_path, ec);
+    if (ec) {
+        return {};
+    }
+    return midll::replay_manifest(entries, ec, options);
+}
+
+//! \overload replay_manifest(const midll::fs::path&, midll::fs::error_code&, const replay_options&)
+inline std::vector<shared_library> replay_manifest(const midll::fs::path& manifest_path,
+                                                   const replay_options& options = {})
+{
+    midll::fs::error_code ec;
+    std::vector<shared_library> result = midll::replay_manifest(manifest_path, ec, options);
+    if (ec) {
+        midll::detail::report_error(ec, "midll::replay_manifest() failed");
+    }
+    return result;
+}
+
+} // namespace midll
@@ -0,0 +1,386 @@
+// Copyright Antony Polukhin, 2015-2024.
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <string>
+#include <vector>
+
+#include <midll/config.hpp>
+#include <midll/detail/system_error.hpp>
+
+#ifndef MIDLL_OS_WINDOWS
+#    include <midll/detail/posix/program_headers.hpp>
+#    include <midll/detail/posix/program_location_impl.hpp>
+#endif
+
+#if defined(MIDLL_HAS_PROGRAM_HEADERS) && (defined(MIDLL_OS_LINUX) || defined(MIDLL_OS_ANDROID))
+#    define MIDLL_HAS_MEMORY_USAGE
+
+#    include <cerrno>
+#    include <cstdio>
+#    include <cstdlib>
+#    include <cstring>
+
+#    include <unistd.h>
+#endif
+
+/// \file midll/memory_usage.hpp
+/// \brief Contains the midll::memory_usage_report() function and the types that describe the memory used by the
+/// loaded binaries. Accounting is supported only on Linux, MIDLL_HAS_MEMORY_USAGE is defined if it is available.
+
+namespace midll
+{
+
+/*!
+ * \brief Memory counters of a part of a binary, in bytes. See `/proc/<pid>/smaps` in `man 5 proc` for the meaning.
+ */
+struct memory_counters
+{
+    std::uint64_t rss = 0;           ///< Resident memory
+    std::uint64_t pss = 0;           ///< Resident memory divided by the count of processes that share it
+    std::uint64_t private_dirty = 0; ///< Modified memory that is not shared with other processes
+    std::uint64_t swap = 0;          ///< Memory that was swapped out
+
+    memory_counters& operator+=(const memory_counters& rhs) noexcept
+    {
+        rss += rhs.rss;
+        pss += rhs.pss;
+        private_dirty += rhs.private_dirty;
+        swap += rhs.swap;
+        return *this;
+    }
+};
+
+/*!
+ * \brief Memory used by the segments of a loaded binary.
+ */
+struct library_memory_usage
+{
+    memory_counters text;  ///< Executable segments
+    memory_counters data;  ///< Other segments: read only data, writable data and bss, without the relro part
+    memory_counters relro; ///< Data that is made read only after relocation (PT_GNU_RELRO)
+
+    /// \return Sum of the text, data and relro counters.
+    memory_counters total() const noexcept
+    {
+        memory_counters result = text;
+        result += data;
+        result += relro;
+        return result;
+    }
+};
+
+/*!
+ * \brief Memory used by one of the binaries loaded into the process, see midll::memory_usage_report().
+ */
+struct module_memory_usage
+{
+    std::string name;           ///< Path of the binary, \forcedlink{program_location} for the main program
+    library_memory_usage usage; ///< Memory used by the segments of the binary
+};
+
+/// @cond
+namespace detail
+{
+
+#ifdef MIDLL_HAS_MEMORY_USAGE
+
+// Page aligned address range of a binary, counters of the `/proc/self/smaps` entries are added to the `part` of
+// the usage number `index`.
+struct memory_range
+{
+    std::uintptr_t begin;
+    std::uintptr_t end;
+    std::size_t index;
+    memory_counters library_memory_usage::*part;
+};
+
+// Appends the ranges of the segments of a binary. Ranges are page aligned and do not overlap.
+inline void append_memory_ranges(std::vector<memory_range>& ranges, const ElfW(Phdr) * phdrs, std::size_t count,
+                                 ElfW(Addr) base, std::size_t index)
+{
+    const std::uintptr_t page_size = static_cast<std::uintptr_t>(::sysconf(_SC_PAGESIZE));
+    const std::size_t first = ranges.size();
+
+    const ElfW(Phdr)* relro = nullptr;
+    for (std::size_t i = 0; i < count; ++i) {
+        const ElfW(Phdr)& phdr = phdrs[i];
+        if (phdr.p_type == PT_GNU_RELRO) {
+            relro = &phdr;
+        }
+        if (phdr.p_type != PT_LOAD || !phdr.p_memsz) {
+            continue;
+        }
+
+        const std::uintptr_t begin = static_cast<std::uintptr_t>(base + phdr.p_vaddr) & ~(page_size - 1);
+        const std::uintptr_t end =
+            (static_cast<std::uintptr_t>(base + phdr.p_vaddr + phdr.p_memsz) + page_size - 1) & ~(page_size - 1);
+        const auto part = (phdr.p_flags & PF_X) ? &library_memory_usage::text : &library_memory_usage::data;
+        ranges.push_back(memory_range{begin, end, index, part});
+    }
+
+    std::sort(ranges.begin() + static_cast<std::ptrdiff_t>(first), ranges.end(),
+              [](const memory_range& l, const memory_range& r) { return l.begin < r.begin; });
+    for (std::size_t i = first + 1; i < ranges.size(); ++i) {
+        // Segments that share a page: the page is accounted to the first of them
+        ranges[i].begin = (std::max)(ranges[i].begin, ranges[i - 1].end);
+    }
+
+    if (!relro) {
+        return;
+    }
+
+    // The loader makes only the whole pages of relro read only, the tail of the last page stays in data
+    const std::uintptr_t relro_begin = static_cast<std::uintptr_t>(base + relro->p_vaddr) & ~(page_size - 1);
+    const std::uintptr_t relro_end = static_cast<std::uintptr_t>(base + relro->p_vaddr + relro->p_memsz)
+                                     & ~(page_size - 1);
+    const std::size_t last = ranges.size();
+    for (std::size_t i = first; i < last && relro_begin < relro_end; ++i) {
+        const memory_range r = ranges[i];
+        if (r.end <= relro_begin || relro_end <= r.begin) {
+            continue;
+        }
+
+        const std::uintptr_t begin = (std::max)(r.begin, relro_begin);
+        const std::uintptr_t end = (std::min)(r.end, relro_end);
+        ranges[i].end = begin;
+        ranges.push_back(memory_range{begin, end, index, &library_memory_usage::relro});
+        if (end < r.end) {
+            ranges.push_back(memory_range{end, r.end, index, r.part});
+        }
+    }
+
+    ranges.erase(std::remove_if(ranges.begin() + static_cast<std::ptrdiff_t>(first), ranges.end(),
+                                [](const memory_range& r) { return r.begin >= r.end; }),
+                 ranges.end());
+}
+
+// Adds the counters of each `/proc/self/smaps` entry to the ranges it overlaps. Entries that overlap a range
+// partially are split proportionally to the size of the overlap.
+inline void accumulate_smaps(std::vector<memory_range>& ranges, library_memory_usage* usages,
+                             midll::fs::error_code& ec)
+{
+    std::sort(ranges.begin(), ranges.end(),
+              [](const memory_range& l, const memory_range& r) { return l.begin < r.begin; });
+
+    std::FILE* const f = std::fopen("/proc/self/smaps", "re");
+    if (!f) {
+        ec = midll::fs::error_code(errno, midll::fs::system_category());
+        return;
+    }
+
+    struct entry_t
+    {
+        std::uintptr_t begin = 0;
+        std::uintptr_t end = 0;
+        std::vector<memory_range>::iterator first;
+        memory_counters counters;
+    } entry;
+    entry.first = ranges.end();
+
+    const auto flush = [&ranges, usages](entry_t& e) {
+        for (auto it = e.first; it != ranges.end() && it->begin < e.end; ++it) {
+            const std::uintptr_t begin = (std::max)(it->begin, e.begin);
+            const std::uintptr_t end = (std::min)(it->end, e.end);
+            if (begin >= end) {
+                continue;
+            }
+
+            memory_counters& out = usages[it->index].*(it->part);
+            if (begin == e.begin && end == e.end) {
+                out += e.counters;
+                continue;
+            }
+
+            const double share = static_cast<double>(end - begin) / static_cast<double>(e.end - e.begin);
+            const auto part = [share](std::uint64_t v) { return static_cast<std::uint64_t>(v * share + 0.5); };
+            out.rss += part(e.counters.rss);
+            out.pss += part(e.counters.pss);
+            out.private_dirty += part(e.counters.private_dirty);
+            out.swap += part(e.counters.swap);
+        }
+        e.first = ranges.end();
+    };
+
+    char* line = nullptr;
+    std::size_t capacity = 0;
+    while (::getline(&line, &capacity, f) > 0) {
+        const char c = line[0];
+        if ((c >= '0' && c <= '9') || (c >= 'a' && c <= 'f')) {
+            // Header of a new entry: "begin-end perms offset dev inode path"
+            flush(entry);
+            char* pos = line;
+            entry.begin = static_cast<std::uintptr_t>(std::strtoull(pos, &pos, 16));
+            entry.end = static_cast<std::uintptr_t>(std::strtoull(pos + 1, nullptr, 16));
+            entry.counters = memory_counters();
+            entry.first = std::upper_bound(ranges.begin(), ranges.end(), entry.begin,
+                                           [](std::uintptr_t addr, const memory_range& r) { return addr < r.end; });
+            if (entry.first != ranges.end() && entry.first->begin >= entry.end) {
+                entry.first = ranges.end();
+            }
+            continue;
+        }
+
+        if (entry.first == ranges.end()) {
+            continue;
+        }
+
+        std::uint64_t* counter = nullptr;
+        std::size_t key_size = 0;
+        if (!std::strncmp(line, "Rss:", 4)) {
+            counter = &entry.counters.rss;
+            key_size = 4;
+        }
+        else if (!std::strncmp(line, "Pss:", 4)) {
+            counter = &entry.counters.pss;
+            key_size = 4;
+        }
+        else if (!std::strncmp(line, "Private_Dirty:", 14)) {
+            counter = &entry.counters.private_dirty;
+            key_size = 14;
+        }
+        else if (!std::strncmp(line, "Swap:", 5)) {
+            counter = &entry.counters.swap;
+            key_size = 5;
+        }
+
+        if (counter) {
+            *counter = static_cast<std::uint64_t>(std::strtoull(line + key_size, nullptr, 10)) * 1024;
+        }
+    }
+    flush(entry);
+
+    std::free(line);
+    std::fclose(f);
+}
+
+inline library_memory_usage library_memory_usage_impl(void* handle, midll::fs::error_code& ec)
+{
+    library_memory_usage usage;
+    // Program headers are used in place after `dl_iterate_phdr` returns, nothing is allocated under the loader lock
+    midll::detail::program_headers_t headers;
+    if (!midll::detail::find_program_headers(handle, headers)) {
+        ec = midll::fs::make_error_code(midll::fs::errc::bad_file_descriptor);
+        return usage;
+    }
+
+    std::vector<memory_range> ranges;
+    midll::detail::append_memory_ranges(ranges, headers.phdr, headers.phnum, headers.base, 0);
+    midll::detail::accumulate_smaps(ranges, &usage, ec);
+    return usage;
+}
+
+#else
+
+inline library_memory_usage library_memory_usage_impl(void* /*handle*/, midll::fs::error_code& ec)
+{
+    ec = midll::fs::make_error_code(midll::fs::errc::operation_not_supported);
+    return {};
+}
+
+#endif
+
+} // namespace detail
+/// @endcond
+
+/*!
+ * Reports the memory used by each binary loaded into the process, with a single pass over `/proc/self/smaps`.
+ * Cheap enough to be sampled periodically: the cost is proportional to the count of memory mappings of the process.
+ *
+ * \b Example:
+ * \code
+ * for (const midll::module_memory_usage& m : midll::memory_usage_report()) {
+ *     std::cout << m.name << ": " << m.usage.total().pss / 1024 << " KiB\n";
+ * }
+ * \endcode
+ *
+ * \param ec Variable that will be set to the result of the operation, `errc::operation_not_supported` on platforms
+ * without `/proc/self/smaps`.
+ * \return Memory used by the loaded binaries, in the order of the dynamic linker.
+ * \throw std::bad_alloc in case of insufficient memory. Overload that does not accept \forcedlinkfs{error_code} also
+ * throws \forcedlinkfs{system_error}.
+ */
+inline std::vector<module_memory_usage> memory_usage_report(midll::fs::error_code& ec)
+{
+    ec.clear();
+    std::vector<module_memory_usage> result;
+
+#ifdef MIDLL_HAS_MEMORY_USAGE
+    struct context_t
+    {
+        std::vector<module_memory_usage>* result;
+        std::vector<midll::detail::memory_range> ranges;
+        std::exception_ptr error;
+    } context = {&result, {}, nullptr};
+
+    result.reserve(64);
+    context.ranges.reserve(64 * 6);
+
+    dl_iterate_phdr(
+        [](struct dl_phdr_info* info, std::size_t, void* data) -> int {
+            context_t& ctx = *static_cast<context_t*>(data);
+
+            // Exceptions must not propagate through the `dl_iterate_phdr` that holds the loader lock
+            try {
+                // Program headers are read under the loader lock, the library could be unloaded right after it
+                midll::detail::append_memory_ranges(ctx.ranges, info->dlpi_phdr, info->dlpi_phnum, info->dlpi_addr,
+                                                    ctx.result->size());
+                ctx.result->push_back(module_memory_usage{info->dlpi_name ? info->dlpi_name : "", {}});
+            }
+            catch (...) {
+                ctx.error = std::current_exception();
+                return 1;
+            }
+            return 0;
+        },
+        &context);
+
+    if (context.error) {
+        std::rethrow_exception(context.error);
+    }
+
+    for (module_memory_usage& m : result) {
+        if (m.name.empty()) {
+            // The main program has no name in the dynamic linker structures
+            midll::fs::error_code ignore;
+            m.name = midll::detail::program_location_impl(ignore).string();
+        }
+    }
+
+    std::vector<library_memory_usage> usages(result.size());
+    midll::detail::accumulate_smaps(context.ranges, usages.data(), ec);
+    for (std::size_t i = 0; i < result.size(); ++i) {
+        result[i].usage = usages[i];
+    }
+    if (ec) {
+        result.clear();
+    }
+#else
+    ec = midll::fs::make_error_code(midll::fs::errc::operation_not_supported);
+#endif
+
+    return result;
+}
+
+//! \overload memory_usage_report(midll::fs::error_code& ec)
+inline std::vector<module_memory_usage> memory_usage_report()
+{
+    midll::fs::error_code ec;
+    std::vector<module_memory_usage> result = midll::memory_usage_report(ec);
+
+    if (ec) {
+        midll::detail::report_error(ec, "midll::memory_usage_report() failed");
+    }
+
+    return result;
+}
+
+} // namespace midll
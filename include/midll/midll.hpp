@@ -7,9 +7,24 @@
 
 #pragma once
 
+#include "address_resolver.hpp"
 #include "alias.hpp"
+#include "buffered_loader_observer.hpp"
+#include "chrome_trace_observer.hpp"
 #include "config.hpp"
+#include "deferred_unload.hpp"
 #include "import.hpp"
+#include "import_set.hpp"
 #include "library_info.hpp"
+#include "library_resolver.hpp"
+#include "link_namespace.hpp"
+#include "loaded_modules.hpp"
+#include "loader_observer.hpp"
+#include "manifest.hpp"
+#include "memory_usage.hpp"
+#include "namespace_pool.hpp"
+#include "plugin_interface.hpp"
+#include "plugin_watcher.hpp"
+#include "reloadable_function.hpp"
 #include "runtime_symbol_info.hpp"
 #include "shared_library.hpp"
@@ -0,0 +1,118 @@
+// Copyright Antony Polukhin, 2015-2024.
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <vector>
+
+#include <midll/config.hpp>
+#include <midll/link_namespace.hpp>
+#include <midll/shared_library.hpp>
+
+/// \file midll/namespace_pool.hpp
+/// \brief Contains only the midll::namespace_pool class that loads independent copies of a library.
+
+namespace midll
+{
+
+/*!
+ * \brief Loads independent copies of the same library, each one into its own linker namespace.
+ *
+ * Copies do not share global variables, so a library with global state could be called from different shards
+ * (threads, workers) without synchronization between the shards.
+ *
+ * The count of namespaces is limited by the platform (see midll::max_link_namespaces) and by the static TLS
+ * space, because each namespace gets own copies of the C and C++ runtimes. The pool loads as many copies as it can,
+ * up to the requested count, and maps shards onto the loaded copies round-robin.
+ *
+ * \b Example:
+ * \code
+ * midll::namespace_pool pool("libplugin.so", worker_count);
+ * // in worker `i`:
+ * pool.for_shard(i).get<int(int)>("process")(42);
+ * \endcode
+ */
+class namespace_pool
+{
+    std::vector<shared_library> libs_;
+
+public:
+    using const_iterator = std::vector<shared_library>::const_iterator;
+
+    /*!
+     * Loads up to `copies` independent copies of the library.
+     *
+     * \param lib_path Library file name. Can handle std::string, const char*, std::wstring,
+     *           const wchar_t* or \forcedlinkfs{path}.
+     * \param copies Wanted count of the copies, must be positive.
+     * \param mode A mode that will be used on library load.
+     * \param ec Variable that will be set to the result of the operation. Set only if no copies were loaded,
+     * `invalid_argument` if `copies` is 0.
+     * \post `size() > 0` if `ec` is not set.
+     * \throw std::bad_alloc in case of insufficient memory.
+     */
+    namespace_pool(const midll::fs::path& lib_path, std::size_t copies, midll::fs::error_code& ec,
+                   load_mode::type mode = load_mode::default_mode)
+    {
+        ec.clear();
+        if (copies == 0) {
+            ec = midll::fs::make_error_code(midll::fs::errc::invalid_argument);
+            return;
+        }
+
+        // Base namespace is not available for the copies
+        const std::size_t count = (copies < max_link_namespaces - 1 ? copies : max_link_namespaces - 1);
+        libs_.reserve(count);
+        for (std::size_t i = 0; i < count; ++i) {
+            shared_library lib(lib_path, link_namespace::create_new(), ec, mode);
+            if (ec) {
+                break;
+            }
+
+            libs_.push_back(std::move(lib));
+        }
+
+        if (!libs_.empty()) {
+            ec.clear();
+        }
+    }
+
+    /*!
+     * Loads up to `copies` independent copies of the library.
+     *
+     * \param lib_path Library file name. Can handle std::string, const char*, std::wstring,
+     *           const wchar_t* or \forcedlinkfs{path}.
+     * \param copies Wanted count of the copies, must be positive.
+     * \param mode A mode that will be used on library load.
+     * \post `size() > 0`.
+     * \throw \forcedlinkfs{system_error} if no copies were loaded, std::bad_alloc in case of insufficient memory.
+     */
+    namespace_pool(const midll::fs::path& lib_path, std::size_t copies, load_mode::type mode = load_mode::default_mode)
+    {
+        midll::fs::error_code ec;
+        namespace_pool(lib_path, copies, ec, mode).libs_.swap(libs_);
+        if (ec) {
+            midll::detail::report_error(ec, "midll::namespace_pool::namespace_pool() failed");
+        }
+    }
+
+    /// \return Count of the loaded copies.
+    std::size_t size() const noexcept { return libs_.size(); }
+
+    /// \return true if no copies were loaded.
+    bool empty() const noexcept { return libs_.empty(); }
+
+    /// \return Copy with the specified index. `i` must be less than `size()`.
+    const shared_library& operator[](std::size_t i) const noexcept { return libs_[i]; }
+
+    /// \return Copy of the library that serves the specified shard. Pool must not be empty.
+    const shared_library& for_shard(std::size_t shard) const noexcept { return libs_[shard % libs_.size()]; }
+
+    const_iterator begin() const noexcept { return libs_.begin(); }
+    const_iterator end() const noexcept { return libs_.end(); }
+};
+
+} // namespace midll
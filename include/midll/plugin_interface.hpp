@@ -0,0 +1,97 @@
+// Copyright Antony Polukhin, 2015-2024.
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <midll/config.hpp>
+
+/// \file midll/plugin_interface.hpp
+/// \brief Contains the MIDLL_INTERFACE macro that declares a struct of symbols resolved by shared_library::bind().
+
+#ifndef MIDLL_INTERFACE_ALIGNMENT
+/// Alignment of the structs declared by MIDLL_INTERFACE, a cache line on the common platforms. Could be redefined
+/// before including the header.
+#    define MIDLL_INTERFACE_ALIGNMENT 64
+#endif
+
+namespace midll
+{
+/// @cond
+namespace detail
+{
+template<class T>
+using interface_member_t = T*;
+} // namespace detail
+/// @endcond
+} // namespace midll
+
+/// @cond
+#define MIDLL_DETAIL_INTERFACE_CAT(a, b) MIDLL_DETAIL_INTERFACE_CAT_I(a, b)
+#define MIDLL_DETAIL_INTERFACE_CAT_I(a, b) a##b
+
+#define MIDLL_DETAIL_INTERFACE_EMPTY()
+
+// Each of the A/B pairs walks the sequence `(name, type)(name, type)...` by alternating between two macros, so
+// that no macro is expanded recursively. Name of the last macro is glued with `_END` to consume it. Expansion of the
+// element macro is deferred until after the gluing, so commas in the types do not break MIDLL_DETAIL_INTERFACE_CAT.
+#define MIDLL_DETAIL_INTERFACE_MEMBER(Name, ...) midll::detail::interface_member_t<__VA_ARGS__> Name = nullptr;
+#define MIDLL_DETAIL_INTERFACE_MEMBER_A(...) \
+    MIDLL_DETAIL_INTERFACE_MEMBER MIDLL_DETAIL_INTERFACE_EMPTY()(__VA_ARGS__) MIDLL_DETAIL_INTERFACE_MEMBER_B
+#define MIDLL_DETAIL_INTERFACE_MEMBER_B(...) \
+    MIDLL_DETAIL_INTERFACE_MEMBER MIDLL_DETAIL_INTERFACE_EMPTY()(__VA_ARGS__) MIDLL_DETAIL_INTERFACE_MEMBER_A
+#define MIDLL_DETAIL_INTERFACE_MEMBER_A_END
+#define MIDLL_DETAIL_INTERFACE_MEMBER_B_END
+
+#define MIDLL_DETAIL_INTERFACE_VISIT(Name, ...) f(api.Name, #Name);
+#define MIDLL_DETAIL_INTERFACE_VISIT_A(...) \
+    MIDLL_DETAIL_INTERFACE_VISIT MIDLL_DETAIL_INTERFACE_EMPTY()(__VA_ARGS__) MIDLL_DETAIL_INTERFACE_VISIT_B
+#define MIDLL_DETAIL_INTERFACE_VISIT_B(...) \
+    MIDLL_DETAIL_INTERFACE_VISIT MIDLL_DETAIL_INTERFACE_EMPTY()(__VA_ARGS__) MIDLL_DETAIL_INTERFACE_VISIT_A
+#define MIDLL_DETAIL_INTERFACE_VISIT_A_END
+#define MIDLL_DETAIL_INTERFACE_VISIT_B_END
+/// @endcond
+
+/*!
+ * \brief Declares a struct with a pointer member per symbol of a plugin, so that all the symbols could be resolved
+ * at once by shared_library::bind() or shared_library::bind_alias().
+ *
+ * Function members are plain function pointers and could be called directly: a call through the struct costs a
+ * single indirect call without reference counting or lookups. Variable members are pointers to the variables.
+ * The struct is aligned to MIDLL_INTERFACE_ALIGNMENT, so a hot interface does not share a cache line with other data.
+ *
+ * The struct does not keep the library loaded, the library must outlive the uses of the members.
+ *
+ * \param Name Name of the struct.
+ * \param Members Sequence of `(symbol_name, type)` pairs without separators. `symbol_name` is both the name of the
+ * member and the name of the symbol (or alias) in the library, `type` is a function or an object type and may
+ * contain commas.
+ *
+ * \b Example:
+ * \code
+ * MIDLL_INTERFACE(plugin_api,
+ *     (create, void*(const char*))
+ *     (destroy, void(void*))
+ *     (version, const int)
+ * )
+ *
+ * midll::shared_library lib("plugin.so");
+ * const plugin_api api = lib.bind<plugin_api>();
+ * void* p = api.create("name");
+ * api.destroy(p);
+ * int v = *api.version;
+ * \endcode
+ */
+#define MIDLL_INTERFACE(Name, Members)                                                            \
+    struct alignas(MIDLL_INTERFACE_ALIGNMENT) Name                                                \
+    {                                                                                             \
+        MIDLL_DETAIL_INTERFACE_CAT(MIDLL_DETAIL_INTERFACE_MEMBER_A Members, _END)                 \
+                                                                                                  \
+        template<class Interface, class F>                                                        \
+        static void midll_interface_visit(Interface& api, F&& f)                                  \
+        {                                                                                         \
+            MIDLL_DETAIL_INTERFACE_CAT(MIDLL_DETAIL_INTERFACE_VISIT_A Members, _END)              \
+        }                                                                                         \
+    }; /**/
@@ -0,0 +1,587 @@
+// Copyright Antony Polukhin, 2015-2024.
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <midll/config.hpp>
+
+#if defined(MIDLL_OS_LINUX)
+#    define MIDLL_HAS_PLUGIN_WATCHER
+
+#    include <algorithm>
+#    include <cerrno>
+#    include <chrono>
+#    include <cstdint>
+#    include <exception>
+#    include <functional>
+#    include <map>
+#    include <memory>
+#    include <mutex>
+#    include <string>
+#    include <thread>
+#    include <unordered_map>
+#    include <utility>
+#    include <vector>
+
+#    include <fcntl.h>
+#    include <poll.h>
+#    include <sys/eventfd.h>
+#    include <sys/inotify.h>
+#    include <sys/mman.h>
+#    include <sys/sendfile.h>
+#    include <sys/stat.h>
+#    include <unistd.h>
+
+#    include <midll/detail/system_error.hpp>
+#    include <midll/library_info.hpp>
+#    include <midll/shared_library.hpp>
+
+/// \file midll/plugin_watcher.hpp
+/// \brief Contains only the midll::plugin_watcher class that loads plugins when they appear in the watched
+/// directories. Available only on Linux, MIDLL_HAS_PLUGIN_WATCHER is defined if the class is available.
+
+namespace midll
+{
+
+/*!
+ * \brief Settings of the midll::plugin_watcher.
+ */
+struct plugin_watcher_options
+{
+    /// Directories to watch. Subdirectories are not watched.
+    std::vector<midll::fs::path> directories;
+
+    /// Symbols that the library must export to be loaded.
+    std::vector<std::string> required_symbols;
+
+    /// Delay between the last write to a file and its loading. Writes during the delay restart it.
+    std::chrono::milliseconds debounce{200};
+
+    /// A mode that will be used on library load.
+    load_mode::type mode = load_mode::default_mode;
+
+    /// Files for which the filter returns false are ignored. By default only files with shared_library::suffix()
+    /// extension are loaded.
+    std::function<bool(const midll::fs::path&)> filter;
+};
+
+/*!
+ * \brief Watches directories with inotify and loads new or updated plugins.
+ *
+ * The watcher reacts to files that are closed after writing or moved into the watched directories. After the debounce
+ * delay the file is validated with midll::library_info (the format and the required symbols), loaded into a new
+ * shared_library and published to all the subscribers. Loading and the callbacks run on the watcher thread, so the
+ * callbacks must not block for long.
+ *
+ * A plugin is loaded from the watched directory, which could be read-only. The dynamic loader returns the already
+ * loaded library for a known path or file, so if a previous version of the plugin is still loaded, the new version
+ * is copied into an anonymous memory file (`memfd_create`) and loaded from it. shared_library::location() of such
+ * a library is `/proc/self/fd/<n>`, the descriptor stays open until the published `std::shared_ptr` releases the
+ * library.
+ *
+ * If the kernel event queue overflows, the error handler receives `no_buffer_space` and the directories are rescanned:
+ * the files that changed since they were processed are loaded again.
+ *
+ * \b Example:
+ * \code
+ * midll::plugin_watcher_options options;
+ * options.directories = {"/opt/app/plugins"};
+ * options.required_symbols = {"create_plugin"};
+ *
+ * midll::plugin_watcher watcher(std::move(options));
+ * watcher.subscribe([&registry](const midll::fs::path& path, std::shared_ptr<midll::shared_library> lib) {
+ *     registry.replace(path.stem().string(), std::move(lib));
+ * });
+ * \endcode
+ */
+class plugin_watcher
+{
+public:
+    /// Callback that receives each successfully loaded plugin.
+    using subscriber = std::function<void(const midll::fs::path&, std::shared_ptr<shared_library>)>;
+
+    /// Callback that receives the plugins that failed validation or loading.
+    using error_handler = std::function<void(const midll::fs::path&, const midll::fs::error_code&)>;
+
+private:
+    using clock = std::chrono::steady_clock;
+    using pending_map = std::map<midll::fs::path, clock::time_point>;
+
+    struct file_version
+    {
+        dev_t device;
+        ino_t inode;
+        std::int64_t mtime;
+
+        bool operator==(const file_version& v) const noexcept
+        {
+            return device == v.device && inode == v.inode && mtime == v.mtime;
+        }
+    };
+
+    plugin_watcher_options options_;
+    int inotify_fd_ = -1;
+    int stop_fd_ = -1;
+    std::unordered_map<int, midll::fs::path> watches_;
+
+    // Versions of the processed files, used only by the watcher thread
+    std::map<midll::fs::path, file_version> versions_;
+
+    std::mutex mutex_;
+    std::size_t next_id_ = 0;
+    std::vector<std::pair<std::size_t, subscriber> > subscribers_;
+    error_handler on_error_;
+
+    std::thread thread_;
+
+    void close_fds() noexcept
+    {
+        if (inotify_fd_ >= 0) {
+            ::close(inotify_fd_);
+            inotify_fd_ = -1;
+        }
+        if (stop_fd_ >= 0) {
+            ::close(stop_fd_);
+            stop_fd_ = -1;
+        }
+    }
+
+    void start(midll::fs::error_code& ec)
+    {
+        ec.clear();
+        if (!options_.filter) {
+            options_.filter = [](const midll::fs::path& p) { return p.extension() == shared_library::suffix(); };
+        }
+
+        inotify_fd_ = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        stop_fd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (inotify_fd_ < 0 || stop_fd_ < 0) {
+            ec = midll::fs::error_code(errno, std::generic_category());
+            close_fds();
+            return;
+        }
+
+        for (const midll::fs::path& dir : options_.directories) {
+            const int wd = ::inotify_add_watch(inotify_fd_, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_ONLYDIR);
+            if (wd < 0) {
+                ec = midll::fs::error_code(errno, std::generic_category());
+                close_fds();
+                return;
+            }
+            watches_.emplace(wd, dir);
+        }
+
+        thread_ = std::thread([this]() { run(); });
+    }
+
+    void run() noexcept
+    {
+        pending_map pending;
+
+        for (;;) {
+            int timeout = -1;
+            if (!pending.empty()) {
+                auto first = std::min_element(pending.begin(), pending.end(), [](const auto& l, const auto& r) {
+                    return l.second < r.second;
+                });
+                const auto left =
+                    std::chrono::duration_cast<std::chrono::milliseconds>(first->second - clock::now()).count();
+                timeout = static_cast<int>(left < 0 ? 0 : left + 1);
+            }
+
+            pollfd fds[2] = {{stop_fd_, POLLIN, 0}, {inotify_fd_, POLLIN, 0}};
+            const int ready = ::poll(fds, 2, timeout);
+            if (ready < 0 && errno != EINTR) {
+                report(midll::fs::path(), midll::fs::error_code(errno, std::generic_category()));
+                return;
+            }
+            if (fds[0].revents) {
+                return;
+            }
+
+            if (fds[1].revents & (POLLERR | POLLHUP | POLLNVAL)) {
+                report(midll::fs::path(), midll::fs::make_error_code(midll::fs::errc::io_error));
+                return;
+            }
+            if ((fds[1].revents & POLLIN) && !read_events(pending, clock::now())) {
+                return;
+            }
+
+            const clock::time_point now = clock::now();
+            for (auto it = pending.begin(); it != pending.end();) {
+                if (it->second <= now) {
+                    process(it->first);
+                    it = pending.erase(it);
+                }
+                else {
+                    ++it;
+                }
+            }
+        }
+    }
+
+    // Returns false if the events could not be read and the watcher must stop
+    bool read_events(pending_map& pending, clock::time_point now) noexcept
+    {
+        alignas(struct inotify_event) char buffer[4096];
+        bool overflow = false;
+        for (;;) {
+            const ssize_t size = ::read(inotify_fd_, buffer, sizeof(buffer));
+            if (size < 0 && errno == EINTR) {
+                continue;
+            }
+            if (size < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+                report(midll::fs::path(), midll::fs::error_code(errno, std::generic_category()));
+                return false;
+            }
+            if (size <= 0) {
+                break;
+            }
+
+            for (ssize_t offset = 0; offset < size;) {
+                const struct inotify_event* e = reinterpret_cast<const struct inotify_event*>(buffer + offset);
+                offset += static_cast<ssize_t>(sizeof(struct inotify_event) + e->len);
+
+                if (e->mask & IN_Q_OVERFLOW) {
+                    overflow = true;
+                    continue;
+                }
+
+                const auto dir = watches_.find(e->wd);
+                if (!e->len || dir == watches_.end()) {
+                    continue;
+                }
+
+                try {
+                    midll::fs::path p = dir->second / e->name;
+                    if (options_.filter(p)) {
+                        pending[std::move(p)] = now + options_.debounce;
+                    }
+                }
+                catch (...) {
+                    // Out of memory or a throwing filter. Skipping the event.
+                }
+            }
+        }
+
+        if (overflow) {
+            // Events were dropped by the kernel, the files that changed since they were processed are reloaded
+            report(midll::fs::path(), midll::fs::make_error_code(midll::fs::errc::no_buffer_space));
+            rescan(pending, now);
+        }
+        return true;
+    }
+
+    void rescan(pending_map& pending, clock::time_point now) noexcept
+    {
+        for (const auto& watch : watches_) {
+            midll::fs::error_code ec;
+            for (midll::fs::directory_iterator it(watch.second, ec), end; !ec && it != end; it.increment(ec)) {
+                try {
+                    const midll::fs::path& p = it->path();
+                    file_version version;
+                    if (!options_.filter(p) || !read_version(p, version)) {
+                        continue;
+                    }
+
+                    const auto known = versions_.find(p);
+                    if (known == versions_.end() || !(known->second == version)) {
+                        pending[p] = now + options_.debounce;
+                    }
+                }
+                catch (...) {
+                    // Out of memory or a throwing filter. Skipping the file.
+                }
+            }
+
+            if (ec) {
+                report(watch.second, ec);
+            }
+        }
+    }
+
+    static bool read_version(const midll::fs::path& p, file_version& version) noexcept
+    {
+        struct stat st;
+        if (::stat(p.c_str(), &st) != 0) {
+            return false;
+        }
+
+        version.device = st.st_dev;
+        version.inode = st.st_ino;
+        version.mtime = static_cast<std::int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+        return true;
+    }
+
+    void report(const midll::fs::path& p, const midll::fs::error_code& ec) noexcept
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (!on_error_) {
+            return;
+        }
+
+        try {
+            error_handler on_error = on_error_;
+            lock.unlock();
+            call_noexcept(on_error, p, ec);
+        }
+        catch (const std::bad_alloc&) {
+            // Could not copy the handler
+        }
+    }
+
+    void process(const midll::fs::path& p) noexcept
+    {
+        midll::fs::error_code ec;
+        std::shared_ptr<shared_library> lib;
+        try {
+            file_version version;
+            if (read_version(p, version)) {
+                versions_[p] = version;
+            }
+
+            midll::fs::error_code not_loaded;
+            if (!shared_library::find_loaded(p, not_loaded)) {
+                ec = validate(p);
+                if (!ec) {
+                    lib = std::make_shared<shared_library>(p, ec, options_.mode);
+                }
+            }
+            else {
+                lib = load_copy(p, ec);
+            }
+        }
+        catch (const std::bad_alloc&) {
+            ec = midll::fs::make_error_code(midll::fs::errc::not_enough_memory);
+        }
+
+        if (ec) {
+            report(p, ec);
+            return;
+        }
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        const std::vector<std::pair<std::size_t, subscriber> > subscribers = subscribers_;
+        lock.unlock();
+        for (const auto& s : subscribers) {
+            call_noexcept(s.second, p, lib);
+        }
+    }
+
+    // The loader returns the already loaded library for a known path or file, so a new version of a plugin which
+    // previous version is still loaded is copied into an anonymous memory file. The descriptor is closed after the
+    // library is released, so that its number and the name of the library are not reused while it is loaded.
+    std::shared_ptr<shared_library> load_copy(const midll::fs::path& p, midll::fs::error_code& ec) const
+    {
+        int fd = copy_to_memfd(p, ec);
+        if (ec) {
+            return {};
+        }
+
+        try {
+            midll::fs::path copy = "/proc/self/fd/" + std::to_string(fd);
+
+            // A library from a closed descriptor with the same number could still be waiting for a deferred unload
+            midll::fs::error_code not_loaded;
+            while (shared_library::find_loaded(copy, not_loaded)) {
+                const int dup = ::fcntl(fd, F_DUPFD_CLOEXEC, fd + 1);
+                if (dup < 0) {
+                    ec = midll::fs::error_code(errno, std::generic_category());
+                    ::close(fd);
+                    return {};
+                }
+                ::close(fd);
+                fd = dup;
+                copy = "/proc/self/fd/" + std::to_string(fd);
+            }
+
+            ec = validate(copy);
+            std::unique_ptr<shared_library> lib;
+            if (!ec) {
+                lib.reset(new shared_library(copy, ec, options_.mode));
+            }
+            if (ec) {
+                ::close(fd);
+                return {};
+            }
+
+            return std::shared_ptr<shared_library>(lib.release(), [fd](shared_library* l) {
+                delete l;
+                ::close(fd);
+            });
+        }
+        catch (...) {
+            ::close(fd);
+            throw;
+        }
+    }
+
+    static int copy_to_memfd(const midll::fs::path& p, midll::fs::error_code& ec) noexcept
+    {
+        const int in = ::open(p.c_str(), O_RDONLY | O_CLOEXEC);
+        if (in < 0) {
+            ec = midll::fs::error_code(errno, std::generic_category());
+            return -1;
+        }
+
+        const int fd = ::memfd_create(p.filename().c_str(), MFD_CLOEXEC);
+        struct stat st;
+        if (fd < 0 || ::fstat(in, &st) != 0) {
+            ec = midll::fs::error_code(errno, std::generic_category());
+        }
+
+        for (off_t left = st.st_size; !ec && left > 0;) {
+            const ssize_t copied = ::sendfile(fd, in, nullptr, static_cast<std::size_t>(left));
+            if (copied > 0) {
+                left -= copied;
+            }
+            else if (copied == 0) {
+                // The file was truncated while copying
+                ec = midll::fs::make_error_code(midll::fs::errc::executable_format_error);
+            }
+            else if (errno != EINTR) {
+                ec = midll::fs::error_code(errno, std::generic_category());
+            }
+        }
+
+        ::close(in);
+        if (ec && fd >= 0) {
+            ::close(fd);
+        }
+        return ec ? -1 : fd;
+    }
+
+    midll::fs::error_code validate(const midll::fs::path& p) const
+    {
+        std::vector<std::string> symbols;
+        try {
+            midll::library_info info(p);
+            if (options_.required_symbols.empty()) {
+                return {};
+            }
+            symbols = info.symbols();
+        }
+        catch (const std::bad_alloc&) {
+            throw;
+        }
+        catch (const std::exception&) {
+            return midll::fs::make_error_code(midll::fs::errc::executable_format_error);
+        }
+
+        std::sort(symbols.begin(), symbols.end());
+        for (const std::string& required : options_.required_symbols) {
+            if (!std::binary_search(symbols.begin(), symbols.end(), required)) {
+                return midll::fs::make_error_code(midll::fs::errc::invalid_seek);
+            }
+        }
+        return {};
+    }
+
+    template<class F, class... Args>
+    static void call_noexcept(const F& f, const Args&... args) noexcept
+    {
+        try {
+            f(args...);
+        }
+        catch (...) {
+            // Exceptions from the callbacks must not stop the watcher thread
+        }
+    }
+
+public:
+    /*!
+     * Starts watching the directories.
+     *
+     * \param options Settings of the watcher.
+     * \param ec Variable that will be set to the result of the operation, for example if one of the directories does
+     * not exist.
+     * \throw std::bad_alloc in case of insufficient memory. Overload that does not accept \forcedlinkfs{error_code}
+     * also throws \forcedlinkfs{system_error}.
+     */
+    plugin_watcher(plugin_watcher_options options, midll::fs::error_code& ec)
+        : options_(std::move(options))
+    {
+        start(ec);
+    }
+
+    //! \overload plugin_watcher(plugin_watcher_options options, midll::fs::error_code& ec)
+    explicit plugin_watcher(plugin_watcher_options options)
+        : options_(std::move(options))
+    {
+        midll::fs::error_code ec;
+        start(ec);
+        if (ec) {
+            throw midll::fs::system_error(ec, "midll::plugin_watcher::plugin_watcher() failed");
+        }
+    }
+
+    plugin_watcher(const plugin_watcher&) = delete;
+    plugin_watcher& operator=(const plugin_watcher&) = delete;
+
+    /*!
+     * Adds a callback that is called on the watcher thread for each loaded plugin.
+     *
+     * \return Identifier of the subscription for unsubscribe().
+     * \throw std::bad_alloc in case of insufficient memory.
+     */
+    std::size_t subscribe(subscriber s)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        subscribers_.emplace_back(next_id_, std::move(s));
+        return next_id_++;
+    }
+
+    /*!
+     * Removes the subscription. The callback could still be called once if a plugin is being published right now.
+     *
+     * \throw Nothing.
+     */
+    void unsubscribe(std::size_t id) noexcept
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        subscribers_.erase(std::remove_if(subscribers_.begin(), subscribers_.end(),
+                                          [id](const auto& s) { return s.first == id; }),
+                           subscribers_.end());
+    }
+
+    /*!
+     * Sets the callback that is called on the watcher thread for each plugin that failed validation or loading:
+     * `executable_format_error` if the file is not a library, `invalid_seek` if a required symbol is missing, or the
+     * error of the load.
+     *
+     * Errors of the watcher itself are reported with an empty path: `no_buffer_space` if events were lost, or the
+     * error of waiting for or reading the events, after which the watcher thread stops. A directory that could not be
+     * rescanned is reported with its path.
+     *
+     * \throw std::bad_alloc in case of insufficient memory.
+     */
+    void on_error(error_handler h)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        on_error_ = std::move(h);
+    }
+
+    /*!
+     * Stops the watcher thread. Pending events are dropped.
+     *
+     * \throw Nothing.
+     */
+    void stop() noexcept
+    {
+        if (thread_.joinable()) {
+            const std::uint64_t one = 1;
+            (void)!::write(stop_fd_, &one, sizeof(one));
+            thread_.join();
+        }
+        close_fds();
+    }
+
+    ~plugin_watcher() { stop(); }
+};
+
+} // namespace midll
+
+#endif
@@ -0,0 +1,236 @@
+// Copyright Antony Polukhin, 2015-2024.
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <midll/config.hpp>
+#include <midll/shared_library.hpp>
+
+/// \file midll/reloadable_function.hpp
+/// \brief Contains only the midll::reloadable_function class template for functions that could be swapped to a
+/// newer version of a library while they are being called.
+
+namespace midll
+{
+
+/*!
+ * \brief Function imported from a library that could be switched to another version of the library while other
+ * threads call it.
+ *
+ * Calls do a single acquire load of the function pointer and do not touch any reference counters. Libraries with the
+ * replaced versions of the function are unloaded using the quiescent state based reclamation: each thread that calls
+ * the function registers a reader via make_reader() and periodically reports a quiescent state, a point where it
+ * holds no pointers obtained from the function object and runs no code from the library (for example between two
+ * requests). An old library is unloaded after all the registered readers passed a quiescent state.
+ *
+ * Calls from the threads without a registered reader are not protected from the unloading.
+ *
+ * \b Example:
+ * \code
+ * midll::reloadable_function<int(int)> f("libplugin.so", "process");
+ *
+ * // worker thread
+ * auto reader = f.make_reader();
+ * while (auto request = queue.pop()) {
+ *     f(request->value);
+ *     reader.quiescent();
+ * }
+ *
+ * // control thread
+ * f.reload("libplugin.so.2");
+ * \endcode
+ *
+ * \tparam T Function type.
+ */
+template<class T>
+class reloadable_function
+{
+    static_assert(std::is_function_v<T>, "midll::reloadable_function<T> supports only function types");
+
+    struct version
+    {
+        shared_library lib;
+        std::uint64_t retired_at;
+    };
+
+    std::atomic<T*> func_{nullptr};
+    std::string name_;
+    load_mode::type mode_;
+
+    std::atomic<std::uint64_t> epoch_{1};
+    mutable std::mutex mutex_;
+    shared_library current_;
+    std::vector<version> retired_;
+    std::list<std::atomic<std::uint64_t> > readers_;
+
+public:
+    /*!
+     * \brief Thread registration that allows reclamation of the replaced libraries.
+     *
+     * Readers are created by reloadable_function::make_reader() and must not outlive the function object.
+     */
+    class reader
+    {
+        friend class reloadable_function;
+
+        reloadable_function* owner_;
+        typename std::list<std::atomic<std::uint64_t> >::iterator it_;
+
+        reader(reloadable_function& owner, typename std::list<std::atomic<std::uint64_t> >::iterator it) noexcept
+            : owner_(&owner)
+            , it_(it)
+        {
+        }
+
+    public:
+        reader(reader&& other) noexcept
+            : owner_(other.owner_)
+            , it_(other.it_)
+        {
+            other.owner_ = nullptr;
+        }
+
+        reader& operator=(reader&&) = delete;
+
+        /*!
+         * Reports that the thread holds no pointers from the function object and runs no code from its library.
+         * Does nothing for a moved-from reader.
+         *
+         * \throw Nothing.
+         */
+        void quiescent() noexcept
+        {
+            if (owner_) {
+                it_->store(owner_->epoch_.load(std::memory_order_seq_cst));
+            }
+        }
+
+        ~reader()
+        {
+            if (owner_) {
+                std::lock_guard<std::mutex> lock(owner_->mutex_);
+                owner_->readers_.erase(it_);
+            }
+        }
+    };
+
+    /*!
+     * Loads the library and resolves the function.
+     *
+     * \param lib Path to shared library to load function from.
+     * \param name Null-terminated C or C++ mangled name of the function. Used on each reload.
+     * \param mode A mode that will be used on library loads.
+     * \throw \forcedlinkfs{system_error} if the library could not be loaded or there is no such symbol,
+     * std::bad_alloc in case of insufficient memory.
+     */
+    reloadable_function(const midll::fs::path& lib, std::string name, load_mode::type mode = load_mode::default_mode)
+        : name_(std::move(name))
+        , mode_(mode)
+        , current_(lib, mode)
+    {
+        func_.store(&current_.get<T>(name_), std::memory_order_release);
+    }
+
+    reloadable_function(const reloadable_function&) = delete;
+    reloadable_function& operator=(const reloadable_function&) = delete;
+
+    /*!
+     * Registers a reader for the current thread.
+     *
+     * \throw std::bad_alloc in case of insufficient memory.
+     */
+    reader make_reader()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        readers_.emplace_back(epoch_.load());
+        return reader(*this, std::prev(readers_.end()));
+    }
+
+    /*!
+     * Loads another version of the library and atomically switches the function to it. The previous library is
+     * unloaded after all the readers pass a quiescent state.
+     *
+     * \param lib Path to the new version of the library.
+     * \param ec Variable that will be set to the result of the operation. The function is not switched on error.
+     * \throw std::bad_alloc in case of insufficient memory. Overload that does not accept \forcedlinkfs{error_code}
+     * also throws \forcedlinkfs{system_error}.
+     */
+    void reload(const midll::fs::path& lib, midll::fs::error_code& ec)
+    {
+        shared_library new_lib(lib, ec, mode_);
+        T* const new_func = (ec ? nullptr : new_lib.template try_get<T>(name_, ec));
+        if (!new_func) {
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        retired_.reserve(retired_.size() + 1);
+        func_.store(new_func, std::memory_order_release);
+        const std::uint64_t retired_at = epoch_.fetch_add(1, std::memory_order_seq_cst) + 1;
+        retired_.push_back(version{std::move(current_), retired_at});
+        current_ = std::move(new_lib);
+        reclaim_impl();
+    }
+
+    //! \overload void reload(const midll::fs::path& lib, midll::fs::error_code& ec)
+    void reload(const midll::fs::path& lib)
+    {
+        midll::fs::error_code ec;
+        reload(lib, ec);
+        if (ec) {
+            midll::detail::report_error(ec, "midll::reloadable_function::reload() failed");
+        }
+    }
+
+    /*!
+     * Unloads the replaced libraries that are no longer used by any reader.
+     *
+     * \return Count of the replaced libraries that are still waiting for the readers.
+     * \throw Nothing.
+     */
+    std::size_t reclaim() noexcept
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        reclaim_impl();
+        return retired_.size();
+    }
+
+    /// \return Pointer to the current version of the function.
+    T* get() const noexcept { return func_.load(std::memory_order_acquire); }
+
+    /// Calls the current version of the function.
+    template<class... Args>
+    inline auto operator()(Args&&... args) const -> decltype((*get())(static_cast<Args&&>(args)...))
+    {
+        return (*func_.load(std::memory_order_acquire))(static_cast<Args&&>(args)...);
+    }
+
+private:
+    /// @cond
+    void reclaim_impl() noexcept
+    {
+        std::uint64_t min_seen = epoch_.load(std::memory_order_seq_cst);
+        for (const std::atomic<std::uint64_t>& seen : readers_) {
+            min_seen = (std::min)(min_seen, seen.load(std::memory_order_seq_cst));
+        }
+
+        retired_.erase(std::remove_if(retired_.begin(), retired_.end(),
+                                      [min_seen](const version& v) { return v.retired_at <= min_seen; }),
+                       retired_.end());
+    }
+    /// @endcond
+};
+
+} // namespace midll
@@ -34,6 +34,8 @@ inline midll::fs::path program_location_impl(midll::fs::error_code& ec)
 /*!
  * On success returns full path and name to the binary object that holds symbol pointed by ptr_to_symbol.
  *
+ * Each call does a `dladdr` and builds a new path. For high rate lookups use \forcedlink{address_resolver}.
+ *
  * \param ptr_to_symbol Pointer to symbol which location is to be determined.
  * \param ec Variable that will be set to the result of the operation.
  * \return Path to the binary object that holds symbol or empty path in case error.
@@ -78,7 +80,7 @@ inline midll::fs::path symbol_location_ptr(T ptr_to_symbol, midll::fs::error_cod
     const int res = dladdr(const_cast<void*>(ptr), &info);
 
     if (res) {
-        ret = info.dli_fname;
+        ret = midll::detail::module_path_from_name(info.dli_fname);
     }
     else {
         midll::detail::reset_dlerror();
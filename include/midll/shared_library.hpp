@@ -10,6 +10,8 @@
 #include <midll/config.hpp>
 #include <midll/detail/aggressive_ptr_cast.hpp>
 #include <midll/detail/system_error.hpp>
+#include <midll/loader_observer.hpp>
+#include <midll/memory_usage.hpp>
 
 #ifdef MIDLL_OS_WINDOWS
 #    include <midll/detail/windows/shared_library_impl.hpp>
@@ -126,6 +128,29 @@ public:
         shared_library::load(lib_path, mode, ec);
     }
 
+    /*!
+     * Loads a library by specified path with a specified mode into the specified linker namespace.
+     *
+     * \param lib_path Library file name. Can handle std::string, const char*, std::wstring,
+     *           const wchar_t* or \forcedlinkfs{path}.
+     * \param ns Namespace to load the library into. `link_namespace::create_new()` loads an independent copy of the
+     *           library into a new namespace.
+     * \param mode A mode that will be used on library load.
+     * \throw \forcedlinkfs{system_error}, std::bad_alloc in case of insufficient memory.
+     */
+    shared_library(const midll::fs::path& lib_path, link_namespace ns, load_mode::type mode = load_mode::default_mode)
+    {
+        shared_library::load(lib_path, ns, mode);
+    }
+
+    //! \overload shared_library(const midll::fs::path& lib_path, link_namespace ns, load_mode::type mode =
+    //! load_mode::default_mode)
+    shared_library(const midll::fs::path& lib_path, link_namespace ns, midll::fs::error_code& ec,
+                   load_mode::type mode = load_mode::default_mode)
+    {
+        shared_library::load(lib_path, ns, ec, mode);
+    }
+
     /*!
      * Assignment operator. If this->is_loaded() then calls this->unload(). Does not invalidate existing symbols and
      * functions loaded from lib.
@@ -169,7 +194,7 @@ public:
      *
      * \throw Nothing.
      */
-    ~shared_library() noexcept {}
+    ~shared_library() noexcept { unload(); }
 
     /*!
      * Makes *this share the same shared object as lib. If *this is loaded, then unloads it.
@@ -197,11 +222,12 @@ public:
             return *this;
         }
 
-        shared_library copy(loc, ec);
+        shared_library copy(loc, lib.namespace_id(), ec);
         if (ec) {
             return *this;
         }
 
+        copy.base_t::defer_unload(lib.base_t::is_unload_deferred());
         swap(copy);
         return *this;
     }
@@ -240,7 +266,7 @@ public:
     {
         midll::fs::error_code ec;
 
-        base_t::load(lib_path, mode, ec);
+        load_observed(lib_path, mode, ec);
 
         if (ec) {
             midll::detail::report_error(ec, "midll::shared_library::load() failed");
@@ -263,7 +289,7 @@ public:
               load_mode::type mode = load_mode::default_mode)
     {
         ec.clear();
-        base_t::load(lib_path, mode, ec);
+        load_observed(lib_path, mode, ec);
     }
 
     //! \overload void load(const midll::fs::path& lib_path, midll::fs::error_code& ec, load_mode::type mode =
@@ -271,7 +297,77 @@ public:
     void load(const midll::fs::path& lib_path, load_mode::type mode, midll::fs::error_code& ec)
     {
         ec.clear();
-        base_t::load(lib_path, mode, ec);
+        load_observed(lib_path, mode, ec);
+    }
+
+    /*!
+     * Loads a library by specified path with a specified mode into the specified linker namespace.
+     *
+     * Note that if some library is already loaded in this instance, load will
+     * call unload() and then load the new provided library.
+     *
+     * \b Example:
+     * \code
+     * shared_library shard1("libplugin.so", link_namespace::create_new());
+     * shared_library shard2("libplugin.so", link_namespace::create_new()); // Does not share globals with shard1
+     * \endcode
+     *
+     * \param lib_path Library file name. Can handle std::string, const char*, std::wstring,
+     *           const wchar_t* or \forcedlinkfs{path}.
+     * \param ns Namespace to load the library into. `link_namespace::create_new()` loads an independent copy of the
+     *           library into a new namespace.
+     * \param mode A mode that will be used on library load.
+     * \throw \forcedlinkfs{system_error}, std::bad_alloc in case of insufficient memory.
+     */
+    void load(const midll::fs::path& lib_path, link_namespace ns, load_mode::type mode = load_mode::default_mode)
+    {
+        midll::fs::error_code ec;
+
+        load_observed(lib_path, mode, ec, ns);
+
+        if (ec) {
+            midll::detail::report_error(ec, "midll::shared_library::load() failed");
+        }
+    }
+
+    //! \overload void load(const midll::fs::path& lib_path, link_namespace ns, load_mode::type mode =
+    //! load_mode::default_mode)
+    void load(const midll::fs::path& lib_path, link_namespace ns, midll::fs::error_code& ec,
+              load_mode::type mode = load_mode::default_mode)
+    {
+        ec.clear();
+        load_observed(lib_path, mode, ec, ns);
+    }
+
+    /*!
+     * Returns the library that is already loaded into the process by the specified path, without loading it.
+     *
+     * Unlike `load()`, never maps a new library, never runs library constructors and relocations, and on POSIX
+     * does not access the filesystem: the path is lexically compared with the names of the loaded libraries.
+     * Path without a parent path, for example "libplugin.so", matches a loaded library with such file name.
+     *
+     * \b Example:
+     * \code
+     * midll::fs::error_code ec;
+     * midll::shared_library lib = midll::shared_library::find_loaded("libplugin.so", ec);
+     * if (!lib) {
+     *     schedule_load("libplugin.so");
+     * }
+     * \endcode
+     *
+     * \param lib_path Library file name. Can handle std::string, const char*, std::wstring,
+     *           const wchar_t* or \forcedlinkfs{path}.
+     * \param ec Variable that will be set to the result of the operation.
+     * \return Loaded library or a library for which `is_loaded()` returns false if no such library is loaded.
+     * \throw std::bad_alloc in case of insufficient memory.
+     */
+    static shared_library find_loaded(const midll::fs::path& lib_path, midll::fs::error_code& ec)
+    {
+        ec.clear();
+
+        shared_library lib;
+        lib.base_t::find_loaded(lib_path, ec);
+        return lib;
     }
 
     /*!
@@ -282,7 +378,19 @@ public:
      * \post this->is_loaded() returns false.
      * \throw Nothing.
      */
-    void unload() noexcept { base_t::unload(); }
+    void unload() noexcept
+    {
+        loader_observer* const observer = midll::detail::current_loader_observer();
+        if (!observer || !is_loaded()) {
+            base_t::unload();
+            return;
+        }
+
+        void* const handle = native();
+        const loader_clock::time_point start = loader_clock::now();
+        base_t::unload();
+        observer->on_unload(unload_event{handle, start, loader_clock::now() - start});
+    }
 
     /*!
      * Check if an library is loaded.
@@ -292,6 +400,101 @@ public:
      */
     bool is_loaded() const noexcept { return base_t::is_loaded(); }
 
+    /*!
+     * Returns the count of 2 MiB pages of the library code that were remapped onto transparent huge pages
+     * by the `load_mode::huge_text` load of this instance. Whether the kernel actually backs them by huge pages
+     * depends on the system transparent huge pages settings.
+     *
+     * \return Count of the remapped huge pages, 0 if `load_mode::huge_text` was not used or not supported.
+     * \throw Nothing.
+     */
+    std::size_t huge_text_pages() const noexcept { return base_t::huge_text_pages(); }
+
+    /*!
+     * Locks all the mapped segments of the loaded library in memory, so that they are not evicted under memory
+     * pressure. Segments are unlocked by `unlock_in_memory()` or `unload()`.
+     *
+     * Locks are counted per loaded library: the segments stay locked until every instance of shared_library that
+     * locked the library unlocks or unloads it.
+     *
+     * \param ec Variable that will be set to the result of the operation. Set to `errc::not_enough_memory` if
+     * RLIMIT_MEMLOCK is too small for the library.
+     * \throw Nothing.
+     */
+    void lock_in_memory(midll::fs::error_code& ec) noexcept
+    {
+        ec.clear();
+        if (!is_loaded()) {
+            ec = midll::fs::make_error_code(midll::fs::errc::bad_file_descriptor);
+            return;
+        }
+
+        base_t::lock_in_memory(ec);
+    }
+
+    //! \overload void lock_in_memory(midll::fs::error_code& ec)
+    //! \throw \forcedlinkfs{system_error} if the library is not loaded or its segments could not be locked.
+    void lock_in_memory()
+    {
+        midll::fs::error_code ec;
+        lock_in_memory(ec);
+        if (ec) {
+            throw midll::fs::system_error(ec, "midll::shared_library::lock_in_memory() failed");
+        }
+    }
+
+    /*!
+     * Unlocks the segments locked by `lock_in_memory()` or `load_mode::mlock`.
+     *
+     * \throw Nothing.
+     */
+    void unlock_in_memory() noexcept { base_t::unlock_in_memory(); }
+
+    /*!
+     * \return true if the library segments were locked in memory by this instance.
+     * \throw Nothing.
+     */
+    bool is_locked_in_memory() const noexcept { return base_t::is_locked_in_memory(); }
+
+    /*!
+     * Reports the resident memory of the library segments, split into text, data and relro parts. Each call makes
+     * a single pass over `/proc/self/smaps`, use midll::memory_usage_report() to account all the loaded libraries
+     * at once.
+     *
+     * \param ec Variable that will be set to the result of the operation. Set to `errc::bad_file_descriptor` if the
+     * library is not loaded and to `errc::operation_not_supported` on platforms other than Linux.
+     * \return Memory used by the library.
+     * \throw std::bad_alloc in case of insufficient memory.
+     */
+    library_memory_usage memory_usage(midll::fs::error_code& ec) const
+    {
+        ec.clear();
+        if (!is_loaded()) {
+            ec = midll::fs::make_error_code(midll::fs::errc::bad_file_descriptor);
+            return {};
+        }
+
+        return midll::detail::library_memory_usage_impl(native(), ec);
+    }
+
+    //! \overload library_memory_usage memory_usage(midll::fs::error_code& ec) const
+    //! \throw \forcedlinkfs{system_error} if the library is not loaded or the accounting failed.
+    library_memory_usage memory_usage() const
+    {
+        midll::fs::error_code ec;
+        library_memory_usage usage = memory_usage(ec);
+        if (ec) {
+            throw midll::fs::system_error(ec, "midll::shared_library::memory_usage() failed");
+        }
+        return usage;
+    }
+
+    /*!
+     * \return Linker namespace the library was loaded into, `link_namespace::base()` if the library is not loaded.
+     * \throw Nothing.
+     */
+    link_namespace namespace_id() const noexcept { return base_t::namespace_id(); }
+
     /*!
      * Check if an library is not loaded.
      *
@@ -318,7 +521,7 @@ public:
     bool has(const char* symbol_name) const noexcept
     {
         midll::fs::error_code ec;
-        return is_loaded() && !!base_t::symbol_addr(symbol_name, ec) && !ec;
+        return is_loaded() && !!symbol_addr_observed(symbol_name, ec) && !ec;
     }
 
     //! \overload bool has(const char* symbol_name) const
@@ -383,8 +586,274 @@ public:
         return *get<T*>(alias_name.c_str());
     }
 
+    /*!
+     * Returns pointer to the symbol (function or variable) with the given name from the loaded library or nullptr
+     * if there is no such symbol. Unlike get() this function does not throw and does not build error messages,
+     * so it is suitable for probing optional symbols.
+     *
+     * \b Example:
+     * \code
+     * if (auto* f = lib.try_get<int(int)>("optional_function")) {
+     *     f(42);
+     * }
+     * \endcode
+     *
+     * \tparam T Type of the symbol that we are going to import. Must be explicitly specified.
+     * \param symbol_name Null-terminated symbol name. Can handle std::string, char*, const char*.
+     * \param ec Variable that will be set to the result of the operation: `bad_file_descriptor` if the DLL/DSO was not
+     * loaded, other platform dependent error if the symbol does not exist.
+     * \return Pointer to the symbol or nullptr.
+     * \throw Nothing.
+     */
+    template<typename T>
+    inline T* try_get(const char* symbol_name, midll::fs::error_code& ec) const noexcept
+    {
+        static_assert(!std::is_reference_v<T> && !std::is_member_pointer_v<T>,
+                      "midll::shared_library::try_get<T>() does not support references and member pointers");
+
+        return midll::detail::aggressive_ptr_cast<T*>(try_get_void(symbol_name, ec));
+    }
+
+    //! \overload T* try_get(const char* symbol_name, midll::fs::error_code& ec) const noexcept
+    template<typename T>
+    inline T* try_get(const std::string& symbol_name, midll::fs::error_code& ec) const noexcept
+    {
+        return try_get<T>(symbol_name.c_str(), ec);
+    }
+
+    //! \overload T* try_get(const char* symbol_name, midll::fs::error_code& ec) const noexcept
+    template<typename T>
+    inline T* try_get(const char* symbol_name) const noexcept
+    {
+        midll::fs::error_code ec;
+        return try_get<T>(symbol_name, ec);
+    }
+
+    //! \overload T* try_get(const char* symbol_name, midll::fs::error_code& ec) const noexcept
+    template<typename T>
+    inline T* try_get(const std::string& symbol_name) const noexcept
+    {
+        return try_get<T>(symbol_name.c_str());
+    }
+
+    /*!
+     * Returns pointer to the symbol (function or variable) with the given alias name from the loaded library or
+     * nullptr if there is no such alias. Does not throw and does not build error messages.
+     *
+     * \tparam T Type of the symbol that we are going to import. Must be explicitly specified.
+     * \param alias_name Null-terminated alias symbol name. Can handle std::string, char*, const char*.
+     * \param ec Variable that will be set to the result of the operation.
+     * \return Pointer to the symbol or nullptr.
+     * \throw Nothing.
+     */
+    template<typename T>
+    inline T* try_get_alias(const char* alias_name, midll::fs::error_code& ec) const noexcept
+    {
+        T** const alias = try_get<T*>(alias_name, ec);
+        return (alias ? *alias : nullptr);
+    }
+
+    //! \overload T* try_get_alias(const char* alias_name, midll::fs::error_code& ec) const noexcept
+    template<typename T>
+    inline T* try_get_alias(const std::string& alias_name, midll::fs::error_code& ec) const noexcept
+    {
+        return try_get_alias<T>(alias_name.c_str(), ec);
+    }
+
+    //! \overload T* try_get_alias(const char* alias_name, midll::fs::error_code& ec) const noexcept
+    template<typename T>
+    inline T* try_get_alias(const char* alias_name) const noexcept
+    {
+        midll::fs::error_code ec;
+        return try_get_alias<T>(alias_name, ec);
+    }
+
+    //! \overload T* try_get_alias(const char* alias_name, midll::fs::error_code& ec) const noexcept
+    template<typename T>
+    inline T* try_get_alias(const std::string& alias_name) const noexcept
+    {
+        return try_get_alias<T>(alias_name.c_str());
+    }
+
+    /*!
+     * Resolves all the members of a struct declared by MIDLL_INTERFACE in one pass over the symbols of the library.
+     * All the members are looked up even if some of them are missing, so the exception lists all the missing
+     * symbols. The lookups are reported to the loader observer as a single "bind" phase.
+     *
+     * The returned struct holds raw pointers and does not keep the library loaded.
+     *
+     * \b Example:
+     * \code
+     * MIDLL_INTERFACE(plugin_api, (create, void*())(destroy, void(void*)))
+     *
+     * const plugin_api api = lib.bind<plugin_api>();
+     * api.destroy(api.create());
+     * \endcode
+     *
+     * \tparam Interface Struct declared by MIDLL_INTERFACE. Must be explicitly specified.
+     * \return Struct with all the members set.
+     * \throw \forcedlinkfs{system_error} with all the missing names in what() if some symbols do not exist or if the
+     * DLL/DSO was not loaded.
+     */
+    template<class Interface>
+    Interface bind() const
+    {
+        return bind_throwing<Interface, false>("bind");
+    }
+
+    /*!
+     * Same as bind() but reports errors via \forcedlinkfs{error_code}. Members for the missing symbols are nullptr.
+     *
+     * \tparam Interface Struct declared by MIDLL_INTERFACE. Must be explicitly specified.
+     * \param ec Variable that will be set to `invalid_seek` if some symbols are missing or to `bad_file_descriptor`
+     * if the DLL/DSO was not loaded.
+     * \return Struct with the found members set.
+     * \throw Nothing.
+     */
+    template<class Interface>
+    Interface bind(midll::fs::error_code& ec) const noexcept
+    {
+        return bind_impl<Interface, false>(ec, [](const char*) noexcept {});
+    }
+
+    /*!
+     * Same as bind() but resolves the members by alias names, see MIDLL_ALIAS.
+     *
+     * \tparam Interface Struct declared by MIDLL_INTERFACE. Must be explicitly specified.
+     * \return Struct with all the members set.
+     * \throw \forcedlinkfs{system_error} with all the missing names in what() if some aliases do not exist or if the
+     * DLL/DSO was not loaded.
+     */
+    template<class Interface>
+    Interface bind_alias() const
+    {
+        return bind_throwing<Interface, true>("bind_alias");
+    }
+
+    //! \overload Interface bind_alias() const
+    template<class Interface>
+    Interface bind_alias(midll::fs::error_code& ec) const noexcept
+    {
+        return bind_impl<Interface, true>(ec, [](const char*) noexcept {});
+    }
+
 private:
     /// @cond
+    template<class Interface, bool Alias, class OnMissing>
+    Interface bind_impl(midll::fs::error_code& ec, OnMissing on_missing) const noexcept
+    {
+        Interface api{};
+        ec.clear();
+        if (!is_loaded()) {
+            ec = midll::fs::make_error_code(midll::fs::errc::bad_file_descriptor);
+            return api;
+        }
+
+        midll::fs::path subject;
+        if (midll::detail::current_loader_observer()) {
+            try {
+                midll::fs::error_code ignore;
+                subject = base_t::full_module_path(ignore);
+            }
+            catch (...) {
+                // Path is only used to describe the phase
+            }
+        }
+        midll::detail::observed_phase phase("bind", subject);
+
+        Interface::midll_interface_visit(api, [this, &ec, &on_missing](auto& member, const char* name) {
+            using member_t = std::remove_reference_t<decltype(member)>;
+
+            midll::fs::error_code symbol_ec;
+            void* symbol = symbol_addr_observed(name, symbol_ec);
+            if constexpr (Alias) {
+                symbol = (symbol && !symbol_ec ? *static_cast<void**>(symbol) : nullptr);
+            }
+
+            if (!symbol || symbol_ec) {
+                ec = midll::fs::make_error_code(midll::fs::errc::invalid_seek);
+                on_missing(name);
+                return;
+            }
+            member = midll::detail::aggressive_ptr_cast<member_t>(symbol);
+        });
+        return api;
+    }
+
+    template<class Interface, bool Alias>
+    Interface bind_throwing(const char* function) const
+    {
+        std::string missing;
+        midll::fs::error_code ec;
+        Interface api = bind_impl<Interface, Alias>(ec, [&missing](const char* name) noexcept {
+            try {
+                missing += (missing.empty() ? "" : ", ");
+                missing += name;
+            }
+            catch (...) {
+                // Names are only used for the message
+            }
+        });
+        if (!ec) {
+            return api;
+        }
+
+        std::string message = std::string("midll::shared_library::") + function + "() failed";
+        message += (missing.empty() ? std::string(": no library was loaded") : ", missing symbols: " + missing);
+        throw midll::fs::system_error(ec, message);
+    }
+
+    void load_observed(const midll::fs::path& lib_path, load_mode::type mode, midll::fs::error_code& ec,
+                       link_namespace ns = link_namespace::base())
+    {
+        loader_observer* const observer = midll::detail::current_loader_observer();
+        if (!observer) {
+            base_t::load(lib_path, mode, ec, ns);
+            return;
+        }
+
+        unload();
+        const loader_clock::time_point start = loader_clock::now();
+        base_t::load(lib_path, mode, ec, ns);
+        const loader_clock::duration duration = loader_clock::now() - start;
+
+        midll::fs::path resolved_path;
+        if (!ec) {
+            midll::fs::error_code ignore;
+            resolved_path = base_t::full_module_path(ignore);
+        }
+        observer->on_load(load_event{lib_path, resolved_path, mode, ec, native(), start, duration});
+    }
+
+    void* symbol_addr_observed(const char* sb, midll::fs::error_code& ec) const noexcept
+    {
+        loader_observer* const observer = midll::detail::current_loader_observer();
+        if (!observer) {
+            return base_t::symbol_addr(sb, ec);
+        }
+
+        const loader_clock::time_point start = loader_clock::now();
+        void* const ret = base_t::symbol_addr(sb, ec);
+        observer->on_symbol(symbol_event{sb, native(), ret && !ec, start, loader_clock::now() - start});
+        return ret;
+    }
+
+    void* try_get_void(const char* sb, midll::fs::error_code& ec) const noexcept
+    {
+        ec.clear();
+        if (!is_loaded()) {
+            ec = midll::fs::make_error_code(midll::fs::errc::bad_file_descriptor);
+            return nullptr;
+        }
+
+        void* const ret = symbol_addr_observed(sb, ec);
+        if (!ret && !ec) {
+            ec = midll::fs::make_error_code(midll::fs::errc::invalid_seek);
+        }
+
+        return (ec ? nullptr : ret);
+    }
+
     // get_void is required to reduce binary size: it does not depend on a template
     // parameter and will be instantiated only once.
     void* get_void(const char* sb) const
@@ -398,7 +867,7 @@ private:
             throw midll::fs::system_error(ec, "midll::shared_library::get() failed: no library was loaded");
         }
 
-        void* const ret = base_t::symbol_addr(sb, ec);
+        void* const ret = symbol_addr_observed(sb, ec);
         if (ec || !ret) {
             midll::detail::report_error(ec, "midll::shared_library::get() failed");
         }
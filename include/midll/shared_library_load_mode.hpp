@@ -32,6 +32,19 @@ namespace load_mode
  * options</a>, <a href="http://pubs.opengroup.org/onlinepubs/000095399/functions/dlopen.html">POSIX specific
  * options</a>.
  *
+ * \b huge_text (Linux only): after a successful load the 2 MiB aligned parts of the executable segments are copied
+ * onto anonymous transparent huge pages, reducing iTLB misses for libraries with large code. Profilers and debuggers
+ * that rely on file backed mappings lose the file name of the remapped code. See shared_library::huge_text_pages().
+ *
+ * \b mlock (Linux and FreeBSD only): after a successful load all the mapped segments of the library are locked in
+ * memory. Load fails if the segments could not be locked. See shared_library::lock_in_memory().
+ *
+ * \b prefault (Linux and FreeBSD only): after a successful load the readable segments of the library are faulted in,
+ * so that the first calls into the library do not wait for the disk. Failures are ignored.
+ *
+ * \b deferred_unload: unload() and the destructor hand the native handle to a background thread instead of closing it
+ * in place, so the thread that drops the library does not run the library destructors. See
+ * midll::flush_deferred_unloads() and midll::deferred_unload_statistics().
  */
 
 enum type
@@ -47,7 +60,11 @@ enum type
     rtld_local = 0,
 
     append_decorations = 0x00800000,
-    search_system_folders = (append_decorations << 1)
+    search_system_folders = (append_decorations << 1),
+    huge_text = 0,
+    mlock = 0,
+    deferred_unload = (search_system_folders << 1),
+    prefault = 0
 #else
     default_mode = 0,
     dont_resolve_dll_references = 0,
@@ -59,7 +76,11 @@ enum type
     rtld_local = RTLD_LOCAL,
 
     append_decorations = 0x00800000,
-    search_system_folders = (append_decorations << 1)
+    search_system_folders = (append_decorations << 1),
+    huge_text = (search_system_folders << 1),
+    mlock = (huge_text << 1),
+    deferred_unload = (mlock << 1),
+    prefault = (deferred_unload << 1)
 #endif
 };
 
@@ -0,0 +1,75 @@
+#include <cstdio>
+
+#include <gtest/gtest.h>
+
+#include <midll/midll.hpp>
+
+TEST(test_address_resolver, resolve)
+{
+    midll::address_resolver resolver;
+    midll::fs::error_code ec;
+
+#if defined(MIDLL_OS_LINUX) || defined(MIDLL_OS_FREEBSD)
+    std::string_view name = resolver.resolve(reinterpret_cast<const void*>(&std::printf), ec);
+    EXPECT_FALSE(ec);
+    EXPECT_TRUE(midll::fs::equivalent(name, midll::symbol_location_ptr(&std::printf)));
+    EXPECT_EQ(resolver.resolve(reinterpret_cast<const void*>(&std::printf)), name);
+
+    name = resolver.resolve(reinterpret_cast<const void*>(&midll::loaded_modules_generation), ec);
+    EXPECT_FALSE(ec);
+    EXPECT_EQ(midll::fs::path(name), midll::program_location());
+
+    resolver.resolve(nullptr, ec);
+    EXPECT_TRUE(ec);
+    EXPECT_TRUE(resolver.find(nullptr).empty());
+
+    const std::size_t segments = resolver.size();
+    std::string_view library_name;
+    {
+        // A library that no other test keeps loaded, so that it is not in the table yet
+        midll::shared_library lib(midll::fs::absolute(midll::shared_library::decorate("synthetic_probe")));
+        const void* symbol = &lib.get<int>("synthetic_variable_1");
+
+        // Table is stale, but `find` does not refresh it
+        EXPECT_TRUE(resolver.find(symbol).empty());
+
+        library_name = resolver.resolve(symbol, ec);
+        EXPECT_FALSE(ec);
+        EXPECT_EQ(midll::fs::path(library_name), lib.location());
+        EXPECT_EQ(resolver.find(symbol), library_name);
+        EXPECT_GT(resolver.size(), segments);
+    }
+
+    // Interned names outlive the unloaded libraries
+    EXPECT_EQ(midll::fs::path(library_name).filename(), midll::shared_library::decorate("synthetic_probe"));
+
+    // Addresses that are not in the table make the resolver check the generation
+    midll::address_resolver rare_checks(1000);
+    midll::address_resolver every_lookup(1);
+    {
+        // Plain C library without unique symbols, so that it is really unmapped on unload
+        midll::shared_library lib(midll::fs::absolute(midll::shared_library::decorate("synthetic_1k")));
+        const void* symbol = &lib.get<int>("synthetic_variable_1");
+        const std::string_view name = rare_checks.resolve(symbol);
+        EXPECT_EQ(midll::fs::path(name), lib.location());
+        EXPECT_EQ(midll::fs::path(every_lookup.resolve(symbol)), lib.location());
+
+        const std::uint64_t generation = midll::loaded_modules_generation();
+        lib.unload();
+        if (generation != midll::loaded_modules_generation()) {
+            // Hits are trusted until the next periodic check
+            EXPECT_EQ(rare_checks.resolve(symbol, ec), name);
+            EXPECT_FALSE(ec);
+
+            every_lookup.resolve(symbol, ec);
+            EXPECT_TRUE(ec);
+        }
+        else {
+            ADD_FAILURE() << "synthetic_1k was not unmapped";
+        }
+    }
+#else
+    resolver.resolve(reinterpret_cast<const void*>(&std::printf), ec);
+    EXPECT_TRUE(ec);
+#endif
+}
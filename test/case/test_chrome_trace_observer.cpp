@@ -0,0 +1,78 @@
+#include <gtest/gtest.h>
+
+#include <midll/midll.hpp>
+
+#include <sstream>
+#include <string>
+
+TEST(test_chrome_trace_observer, load_phases)
+{
+    const auto path = midll::shared_library::decorate("test_library");
+
+    std::ostringstream out;
+    {
+        midll::chrome_trace_observer trace(out);
+        midll::set_loader_observer(&trace);
+        {
+            midll::shared_library sl(path);
+            EXPECT_EQ(sl.get<int>("integer_g"), 100);
+            midll::library_info info(path);
+            EXPECT_FALSE(info.symbols().empty());
+        }
+        midll::library_resolver resolver({midll::fs::current_path()});
+        EXPECT_NE(resolver.size(), 0u);
+        midll::set_loader_observer(nullptr);
+    }
+
+    const std::string json = out.str();
+    ASSERT_GE(json.size(), 2u);
+    EXPECT_EQ(json.front(), '[');
+    EXPECT_EQ(json.substr(json.size() - 3), "\n]\n");
+
+    EXPECT_NE(json.find("\"cat\":\"midll.load\""), std::string::npos);
+    EXPECT_NE(json.find("\"name\":\"" + path.filename().string() + "\""), std::string::npos);
+    EXPECT_NE(json.find("\"name\":\"resolve_path\""), std::string::npos);
+    EXPECT_NE(json.find("\"name\":\"open\""), std::string::npos);
+    EXPECT_NE(json.find("\"name\":\"integer_g\",\"cat\":\"midll.symbol\""), std::string::npos);
+    EXPECT_NE(json.find("\"found\":true"), std::string::npos);
+    EXPECT_NE(json.find("\"name\":\"library_info\""), std::string::npos);
+    EXPECT_NE(json.find("\"name\":\"directory_scan\""), std::string::npos);
+    EXPECT_NE(json.find("\"ph\":\"X\""), std::string::npos);
+    EXPECT_NE(json.find("\"tid\":"), std::string::npos);
+}
+
+#if defined(MIDLL_OS_LINUX) || defined(MIDLL_OS_FREEBSD)
+TEST(test_chrome_trace_observer, prefault_phase)
+{
+    const auto path = midll::shared_library::decorate("synthetic_1k");
+
+    std::ostringstream out;
+    {
+        midll::chrome_trace_observer trace(out);
+        midll::set_loader_observer(&trace);
+        {
+            midll::shared_library sl(path, midll::load_mode::prefault);
+            EXPECT_EQ(sl.get<int(int)>("synthetic_function_5")(1), 6);
+        }
+        midll::set_loader_observer(nullptr);
+    }
+
+    EXPECT_NE(out.str().find("\"name\":\"prefault\""), std::string::npos);
+}
+#endif
+
+TEST(test_chrome_trace_observer, negative_timestamp)
+{
+    const midll::loader_clock::time_point before = midll::loader_clock::now();
+    const midll::fs::path subject("early");
+
+    std::ostringstream out;
+    {
+        midll::chrome_trace_observer trace(out);
+        // Event started less than a microsecond before the trace origin
+        trace.on_phase(midll::phase_event{"early", subject, before - std::chrono::nanoseconds(500),
+                                          std::chrono::nanoseconds(100)});
+    }
+
+    EXPECT_NE(out.str().find("\"ts\":-"), std::string::npos) << out.str();
+}
@@ -0,0 +1,119 @@
+#include <gtest/gtest.h>
+
+#include <midll/midll.hpp>
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace
+{
+struct allocation_counter
+{
+    std::size_t allocations = 0;
+    std::size_t deallocations = 0;
+};
+
+template<class T>
+struct counting_allocator
+{
+    using value_type = T;
+
+    allocation_counter* counter;
+
+    explicit counting_allocator(allocation_counter& c) noexcept
+        : counter(&c)
+    {
+    }
+
+    template<class U>
+    counting_allocator(const counting_allocator<U>& other) noexcept
+        : counter(other.counter)
+    {
+    }
+
+    T* allocate(std::size_t n)
+    {
+        ++counter->allocations;
+        return std::allocator<T>().allocate(n);
+    }
+
+    void deallocate(T* p, std::size_t n) noexcept
+    {
+        ++counter->deallocations;
+        std::allocator<T>().deallocate(p, n);
+    }
+
+    template<class U>
+    bool operator==(const counting_allocator<U>& other) const noexcept
+    {
+        return counter == other.counter;
+    }
+
+    template<class U>
+    bool operator!=(const counting_allocator<U>& other) const noexcept
+    {
+        return counter != other.counter;
+    }
+};
+} // namespace
+
+TEST(test_import_allocator, import_symbol)
+{
+    const auto path = midll::fs::absolute(midll::shared_library::decorate("test_library"));
+    allocation_counter counter;
+    const counting_allocator<char> alloc(counter);
+
+    {
+        auto f = midll::import_symbol<int(int)>(std::allocator_arg, alloc, path, "increment");
+        EXPECT_EQ(f(1), 2);
+        EXPECT_EQ(counter.allocations, 1u);
+
+        auto i = midll::import_symbol<int>(std::allocator_arg, alloc, path, std::string("integer_g"));
+        EXPECT_EQ(*i, 100);
+
+        midll::shared_library lib(path);
+        auto c = midll::import_alias<const int>(std::allocator_arg, alloc, lib, "const_integer_g_alias");
+        EXPECT_EQ(*c, 777);
+
+        auto bar = midll::import_alias<std::size_t(const std::vector<int>&)>(std::allocator_arg, alloc,
+                                                                              std::move(lib), "foo_bar");
+        EXPECT_EQ(bar(std::vector<int>{1, 2, 3}), 3u);
+        EXPECT_EQ(counter.allocations, 4u);
+        EXPECT_EQ(counter.deallocations, 0u);
+
+        EXPECT_THROW(midll::import_symbol<int>(std::allocator_arg, alloc, path, "symbol_that_does_not_exist"),
+                     midll::fs::system_error);
+        EXPECT_EQ(counter.allocations, 5u);
+        EXPECT_EQ(counter.deallocations, 1u);
+    }
+
+    EXPECT_EQ(counter.deallocations, counter.allocations);
+}
+
+TEST(test_import_allocator, import_set)
+{
+    const auto path = midll::fs::absolute(midll::shared_library::decorate("test_library"));
+    allocation_counter counter;
+
+    {
+        midll::import_set set(std::allocator_arg, counting_allocator<char>(counter), path);
+        auto [f, i] = set.get_all<int(int), int>({"increment", "integer_g"});
+        auto c = set.get_alias<const int>("const_integer_g_alias");
+        EXPECT_EQ(f(41), 42);
+        EXPECT_EQ(*i, 100);
+        EXPECT_EQ(*c, 777);
+
+        // Imported symbols share the control block allocated for the set
+        EXPECT_EQ(counter.allocations, 1u);
+
+        midll::fs::error_code ec;
+        midll::import_set missing(std::allocator_arg, counting_allocator<char>(counter), path.string() + ".1.1.1", ec);
+        EXPECT_TRUE(ec);
+        EXPECT_FALSE(missing);
+    }
+
+    EXPECT_EQ(counter.allocations, 2u);
+    EXPECT_EQ(counter.deallocations, 2u);
+}
@@ -0,0 +1,134 @@
+#include <gtest/gtest.h>
+
+#include <midll/midll.hpp>
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace
+{
+struct phase_counter : midll::loader_observer
+{
+    int binds = 0;
+    int symbols = 0;
+
+    void on_symbol(const midll::symbol_event&) noexcept override { ++symbols; }
+
+    void on_phase(const midll::phase_event& e) noexcept override
+    {
+        if (std::strcmp(e.name, "bind") == 0) {
+            ++binds;
+        }
+    }
+};
+} // namespace
+
+TEST(test_import_set, shares_library)
+{
+    const auto path = midll::fs::absolute(midll::shared_library::decorate("test_library"));
+
+    std::shared_ptr<int> i;
+    {
+        midll::import_set set(path);
+        ASSERT_TRUE(set);
+        EXPECT_EQ(set.use_count(), 1);
+
+        auto f = set.get<int(int)>("increment");
+        i = set.get<int>(std::string("integer_g"));
+        auto c = set.get_alias<const int>("const_integer_g_alias");
+        auto bar = set.get_alias<std::size_t(const std::vector<int>&)>("foo_bar");
+
+        EXPECT_EQ(f(1), 2);
+        EXPECT_EQ(*i, 100);
+        EXPECT_EQ(*c, 777);
+        EXPECT_EQ(bar(std::vector<int>{1, 2, 3}), 3u);
+
+        // One control block for the set and all the imported symbols
+        EXPECT_EQ(set.use_count(), 5);
+        EXPECT_EQ(i.use_count(), 5);
+
+        EXPECT_THROW(set.get<int>("symbol_that_does_not_exist"), midll::fs::system_error);
+
+        midll::fs::error_code ec;
+        EXPECT_FALSE(set.try_get<int>("symbol_that_does_not_exist", ec));
+        EXPECT_TRUE(ec);
+        EXPECT_TRUE(set.try_get_alias<const int>("const_integer_g_alias", ec));
+        EXPECT_FALSE(ec);
+    }
+
+    // Imported variable keeps the library loaded
+    EXPECT_EQ(i.use_count(), 1);
+    EXPECT_EQ(*i, 100);
+}
+
+TEST(test_import_set, get_all)
+{
+    const auto path = midll::fs::absolute(midll::shared_library::decorate("test_library"));
+    midll::import_set set{midll::shared_library(path)};
+
+    auto [f, i] = set.get_all<int(int), int>({"increment", "integer_g"});
+    EXPECT_EQ(f(41), 42);
+    EXPECT_EQ(*i, 100);
+
+    auto [c] = set.get_all_alias<const int>({"const_integer_g_alias"});
+    EXPECT_EQ(*c, 777);
+
+    try {
+        set.get_all<int(int), int, int>({"missing_one", "integer_g", "missing_two"});
+        ADD_FAILURE() << "exception expected";
+    }
+    catch (const midll::fs::system_error& e) {
+        EXPECT_EQ(e.code(), midll::fs::make_error_code(midll::fs::errc::invalid_seek));
+        const std::string what = e.what();
+        EXPECT_NE(what.find("missing_one, missing_two"), std::string::npos) << what;
+    }
+
+    midll::fs::error_code ec;
+    std::vector<std::string> missing;
+    auto [g, j, k] = set.try_get_all<int(int), int, int>({"missing_one", "integer_g", "missing_two"}, ec, missing);
+    EXPECT_EQ(ec, midll::fs::make_error_code(midll::fs::errc::invalid_seek));
+    EXPECT_EQ(missing, (std::vector<std::string>{"missing_one", "missing_two"}));
+    EXPECT_FALSE(g);
+    ASSERT_TRUE(j);
+    EXPECT_EQ(*j, 100);
+    EXPECT_FALSE(k);
+
+    set.try_get_all_alias<const int>({"const_integer_g_alias"}, ec, missing);
+    EXPECT_FALSE(ec);
+    EXPECT_TRUE(missing.empty());
+}
+
+TEST(test_import_set, bind_phase)
+{
+    const auto path = midll::fs::absolute(midll::shared_library::decorate("test_library"));
+    midll::import_set set(path);
+
+    phase_counter observer;
+    midll::set_loader_observer(&observer);
+    set.get_all<int(int), int>({"increment", "integer_g"});
+    midll::set_loader_observer(nullptr);
+
+    EXPECT_EQ(observer.binds, 1);
+    EXPECT_EQ(observer.symbols, 2);
+}
+
+TEST(test_import_set, errors)
+{
+    midll::import_set empty;
+    EXPECT_FALSE(empty);
+    EXPECT_EQ(empty.use_count(), 0);
+    EXPECT_THROW(empty.library(), midll::fs::system_error);
+    EXPECT_THROW(empty.get<int>("integer_g"), midll::fs::system_error);
+    EXPECT_THROW(empty.get_all<int>({"integer_g"}), midll::fs::system_error);
+
+    midll::fs::error_code ec;
+    EXPECT_FALSE(empty.try_get<int>("integer_g", ec));
+    EXPECT_EQ(ec, midll::fs::make_error_code(midll::fs::errc::bad_file_descriptor));
+
+    const auto path = midll::fs::absolute(midll::shared_library::decorate("test_library"));
+    midll::import_set missing(path.string() + ".1.1.1", ec);
+    EXPECT_TRUE(ec);
+    EXPECT_FALSE(missing);
+    EXPECT_THROW(missing.get_all<int>({"integer_g"}), midll::fs::system_error);
+}
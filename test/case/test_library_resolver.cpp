@@ -0,0 +1,112 @@
+#include <gtest/gtest.h>
+
+#include <midll/midll.hpp>
+
+#include <chrono>
+#include <fstream>
+#include <string>
+
+#include <unistd.h>
+
+namespace
+{
+struct temp_dir
+{
+    midll::fs::path path = midll::fs::temp_directory_path() / ("midll_resolver_" + std::to_string(::getpid()));
+
+    temp_dir() { midll::fs::create_directories(path); }
+    ~temp_dir()
+    {
+        midll::fs::error_code ignore;
+        midll::fs::remove_all(path, ignore);
+    }
+};
+} // namespace
+
+TEST(test_library_resolver, resolve_and_load)
+{
+    temp_dir tmp;
+    const midll::fs::path cwd = midll::fs::current_path();
+    midll::library_resolver resolver({tmp.path, cwd});
+
+    const midll::fs::path decorated = midll::shared_library::decorate("test_library");
+    EXPECT_EQ(resolver.resolve("test_library"), cwd / decorated);
+    EXPECT_EQ(resolver.resolve(decorated), cwd / decorated);
+
+    midll::fs::error_code ec;
+    EXPECT_TRUE(resolver.resolve("library_that_does_not_exist", ec).empty());
+    EXPECT_EQ(ec, midll::fs::make_error_code(midll::fs::errc::no_such_file_or_directory));
+    EXPECT_THROW(resolver.resolve("library_that_does_not_exist"), midll::fs::system_error);
+
+    midll::shared_library lib = resolver.load("test_library");
+    EXPECT_TRUE(lib.is_loaded());
+    EXPECT_EQ(lib.get<int>("integer_g"), 100);
+
+    // First root wins after refresh
+    midll::fs::copy_file(cwd / decorated, tmp.path / decorated);
+    EXPECT_EQ(resolver.resolve("test_library"), cwd / decorated);
+    resolver.refresh();
+    EXPECT_EQ(resolver.resolve("test_library"), tmp.path / decorated);
+}
+
+TEST(test_library_resolver, negative_cache)
+{
+    temp_dir tmp;
+    const midll::fs::path late = midll::shared_library::decorate("late_plugin");
+
+    midll::library_resolver cached({tmp.path}, std::chrono::hours(1));
+    midll::library_resolver uncached({tmp.path}, std::chrono::seconds(0));
+
+    midll::fs::error_code ec;
+    cached.resolve("late_plugin", ec);
+    EXPECT_TRUE(ec);
+    uncached.resolve("late_plugin", ec);
+    EXPECT_TRUE(ec);
+
+    std::ofstream(tmp.path / late) << "not a library";
+
+    // Snapshot is trusted for the TTL
+    cached.resolve("late_plugin", ec);
+    EXPECT_TRUE(ec);
+
+    // Miss after the TTL retakes the snapshot
+    EXPECT_EQ(uncached.resolve("late_plugin", ec), tmp.path / late);
+    EXPECT_FALSE(ec);
+
+    cached.refresh();
+    EXPECT_EQ(cached.resolve("late_plugin", ec), tmp.path / late);
+    EXPECT_FALSE(ec);
+}
+
+namespace
+{
+struct scan_counter : midll::loader_observer
+{
+    std::size_t scans = 0;
+
+    void on_phase(const midll::phase_event& e) noexcept override { scans += (std::string(e.name) == "directory_scan"); }
+};
+} // namespace
+
+TEST(test_library_resolver, misses_do_not_touch_filesystem)
+{
+    temp_dir tmp;
+    midll::library_resolver cached({tmp.path, tmp.path / "missing_root"}, std::chrono::hours(1));
+    midll::library_resolver uncached({tmp.path}, std::chrono::seconds(0));
+
+    scan_counter counter;
+    midll::set_loader_observer(&counter);
+    midll::fs::error_code ec;
+    for (int i = 0; i < 1000; ++i) {
+        cached.resolve("missing_plugin_" + std::to_string(i), ec);
+        EXPECT_TRUE(ec);
+    }
+    const std::size_t cached_scans = counter.scans;
+
+    uncached.resolve("missing_plugin", ec);
+    EXPECT_TRUE(ec);
+    midll::set_loader_observer(nullptr);
+
+    EXPECT_EQ(cached_scans, 0u);
+    EXPECT_EQ(counter.scans, 1u);
+}
@@ -0,0 +1,57 @@
+#include <algorithm>
+
+#include <gtest/gtest.h>
+
+#include <midll/midll.hpp>
+
+TEST(test_loaded_modules, snapshot)
+{
+    // test_library is never unmapped once loaded, so a library that no other test keeps loaded is used
+    auto path = midll::fs::absolute(midll::shared_library::decorate("synthetic_probe"));
+
+    midll::fs::error_code ec;
+    midll::loaded_modules_snapshot before = midll::loaded_modules(ec);
+#if defined(MIDLL_OS_LINUX) || defined(MIDLL_OS_FREEBSD)
+    ASSERT_FALSE(ec);
+    EXPECT_FALSE(before.is_stale());
+    EXPECT_EQ(before.generation(), midll::loaded_modules_generation());
+
+    const auto& modules = before.modules();
+    ASSERT_FALSE(modules.empty());
+    EXPECT_TRUE(std::is_sorted(modules.begin(), modules.end(), [&before](const auto& l, const auto& r) {
+        return before.segments_begin(l)->begin < before.segments_begin(r)->begin;
+    }));
+
+    const auto program = std::find_if(modules.begin(), modules.end(), [](const midll::loaded_module& m) {
+        return midll::fs::path(m.name) == midll::program_location();
+    });
+    ASSERT_TRUE(program != modules.end());
+    const auto in_program = [&before, &program](const void* p) {
+        return std::any_of(before.segments_begin(*program), before.segments_end(*program),
+                           [p](const midll::module_segment& s) { return s.contains(p); });
+    };
+    EXPECT_TRUE(in_program(reinterpret_cast<const void*>(&midll::loaded_modules_generation)));
+    EXPECT_FALSE(in_program(reinterpret_cast<const void*>(&std::printf)));
+
+    {
+        midll::shared_library lib(path);
+        EXPECT_TRUE(before.is_stale());
+
+        midll::loaded_modules_snapshot after = midll::loaded_modules();
+        EXPECT_EQ(after.modules().size(), modules.size() + 1);
+
+        const auto library = std::find_if(after.modules().begin(), after.modules().end(),
+                                          [&path](const midll::loaded_module& m) { return m.name == path; });
+        ASSERT_TRUE(library != after.modules().end());
+        EXPECT_GT(library->segments_count, 0u);
+
+        const void* symbol = &lib.get<int>("synthetic_variable_1");
+        EXPECT_TRUE(std::any_of(after.segments_begin(*library), after.segments_end(*library),
+                                [symbol](const midll::module_segment& s) {
+                                    return s.contains(symbol) && (s.flags & midll::module_segment::writable);
+                                }));
+    }
+#else
+    EXPECT_TRUE(ec);
+#endif
+}
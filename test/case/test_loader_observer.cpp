@@ -0,0 +1,107 @@
+#include <gtest/gtest.h>
+
+#include <midll/midll.hpp>
+
+#include <thread>
+#include <vector>
+
+TEST(test_loader_observer, buffered)
+{
+    const auto path = midll::fs::absolute(midll::shared_library::decorate("test_library"));
+
+    midll::buffered_loader_observer observer(4);
+    EXPECT_EQ(midll::set_loader_observer(&observer), nullptr);
+    EXPECT_EQ(midll::get_loader_observer(), &observer);
+
+    void* handle = nullptr;
+    {
+        midll::shared_library sl(path);
+        handle = sl.native();
+        EXPECT_EQ(sl.get<int>("integer_g"), 100);
+        EXPECT_FALSE(sl.has("symbol_that_does_not_exist"));
+
+        midll::fs::error_code ec;
+        midll::shared_library missing(path.string() + ".1.1.1", ec);
+        EXPECT_TRUE(ec);
+    }
+
+    std::thread([path]() { midll::shared_library(path).unload(); }).join();
+
+    EXPECT_EQ(midll::set_loader_observer(nullptr), &observer);
+
+    std::vector<midll::loader_event_record> events;
+    EXPECT_EQ(observer.drain([&events](const midll::loader_event_record& e) { events.push_back(e); }), 6u);
+    EXPECT_EQ(observer.dropped(), 1u);
+    ASSERT_EQ(events.size(), 6u);
+
+    EXPECT_EQ(events[0].kind, midll::loader_event_record::load);
+    EXPECT_FALSE(events[0].ec);
+    EXPECT_EQ(events[0].native_handle, handle);
+    EXPECT_TRUE(midll::fs::equivalent(events[0].name, path));
+    EXPECT_EQ(events[0].thread, std::this_thread::get_id());
+
+    EXPECT_EQ(events[1].kind, midll::loader_event_record::symbol);
+    EXPECT_EQ(events[1].name, "integer_g");
+    EXPECT_FALSE(events[1].ec);
+
+    EXPECT_EQ(events[2].kind, midll::loader_event_record::symbol);
+    EXPECT_TRUE(events[2].ec);
+
+    EXPECT_EQ(events[3].kind, midll::loader_event_record::load);
+    EXPECT_TRUE(events[3].ec);
+    EXPECT_EQ(events[3].native_handle, nullptr);
+
+    // The fifth event of the main thread did not fit into the buffer
+    EXPECT_EQ(events[4].kind, midll::loader_event_record::load);
+    EXPECT_NE(events[4].thread, std::this_thread::get_id());
+    EXPECT_EQ(events[5].kind, midll::loader_event_record::unload);
+    EXPECT_GE(events[5].duration.count(), 0);
+}
+
+TEST(test_loader_observer, buffered_exited_threads)
+{
+    const auto path = midll::fs::absolute(midll::shared_library::decorate("test_library"));
+
+    midll::buffered_loader_observer observer(4);
+    midll::set_loader_observer(&observer);
+
+    // Each thread records a load and an unload. Threads run one after another, so all of them use the same buffer
+    std::thread::id first;
+    for (int i = 0; i < 3; ++i) {
+        std::thread t([path]() { midll::shared_library(path).unload(); });
+        if (!i) {
+            first = t.get_id();
+        }
+        t.join();
+    }
+    midll::set_loader_observer(nullptr);
+
+    std::vector<midll::loader_event_record> events;
+    EXPECT_EQ(observer.drain([&events](const midll::loader_event_record& e) { events.push_back(e); }), 4u);
+    EXPECT_EQ(observer.dropped(), 2u);
+    ASSERT_EQ(events.size(), 4u);
+    EXPECT_EQ(events[0].thread, first);
+    EXPECT_EQ(events[1].thread, first);
+}
+
+TEST(test_loader_observer, drain_callback_loads)
+{
+    const auto path = midll::fs::absolute(midll::shared_library::decorate("test_library"));
+
+    midll::buffered_loader_observer observer;
+    midll::set_loader_observer(&observer);
+
+    // Only the helper thread has a buffer, the callback registers one for this thread
+    std::thread([path]() { midll::shared_library(path).unload(); }).join();
+
+    std::size_t loads_in_callback = 0;
+    EXPECT_EQ(observer.drain([&](const midll::loader_event_record&) {
+        midll::shared_library lib(path);
+        loads_in_callback += lib.is_loaded();
+    }),
+              2u);
+    midll::set_loader_observer(nullptr);
+
+    EXPECT_EQ(loads_in_callback, 2u);
+    EXPECT_EQ(observer.drain([](const midll::loader_event_record&) {}), 4u);
+}
@@ -0,0 +1,85 @@
+#include <gtest/gtest.h>
+
+#include <midll/midll.hpp>
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+TEST(test_manifest, record_and_replay)
+{
+    const auto test_library = midll::shared_library::decorate("test_library");
+    const auto empty_library = midll::shared_library::decorate("empty_library");
+    const auto manifest_path = midll::fs::temp_directory_path() / "midll_test_manifest.txt";
+
+    midll::manifest_recorder recorder;
+    midll::set_loader_observer(&recorder);
+    {
+        midll::shared_library empty(empty_library, midll::load_mode::rtld_global);
+        midll::shared_library sl(test_library);
+        EXPECT_EQ(sl.get<int>("integer_g"), 100);
+        EXPECT_EQ(sl.get<int(int)>("increment")(1), 2);
+        EXPECT_EQ(sl.get<int>("integer_g"), 100);
+        EXPECT_FALSE(sl.has("symbol_that_does_not_exist"));
+
+        // Second load of the same library is not recorded
+        midll::shared_library again(midll::fs::absolute(test_library));
+
+        midll::fs::error_code ec;
+        midll::shared_library missing("midll_library_that_does_not_exist.so", ec);
+        EXPECT_TRUE(ec);
+    }
+    midll::set_loader_observer(nullptr);
+
+    const std::vector<midll::manifest_entry> entries = recorder.entries();
+    ASSERT_EQ(entries.size(), 2u);
+    EXPECT_TRUE(midll::fs::equivalent(entries[0].path, empty_library));
+    EXPECT_EQ(entries[0].mode, midll::load_mode::rtld_global);
+    EXPECT_TRUE(entries[0].symbols.empty());
+    EXPECT_TRUE(midll::fs::equivalent(entries[1].path, test_library));
+    EXPECT_EQ(entries[1].symbols, (std::vector<std::string>{"integer_g", "increment"}));
+
+    recorder.write(manifest_path);
+    const std::vector<midll::manifest_entry> read = midll::read_manifest(manifest_path);
+    ASSERT_EQ(read.size(), entries.size());
+    for (std::size_t i = 0; i < read.size(); ++i) {
+        EXPECT_EQ(read[i].path, entries[i].path);
+        EXPECT_EQ(read[i].mode, entries[i].mode);
+        EXPECT_EQ(read[i].symbols, entries[i].symbols);
+    }
+
+    midll::replay_options options;
+    options.threads = 2;
+    const std::vector<midll::shared_library> libs = midll::replay_manifest(manifest_path, options);
+    ASSERT_EQ(libs.size(), 2u);
+    EXPECT_TRUE(libs[0].is_loaded());
+    ASSERT_TRUE(libs[1].is_loaded());
+    EXPECT_EQ(libs[1].get<int>("integer_g"), 100);
+
+    midll::fs::remove(manifest_path);
+}
+
+TEST(test_manifest, errors)
+{
+    const auto manifest_path = midll::fs::temp_directory_path() / "midll_test_bad_manifest.txt";
+    midll::fs::error_code ec;
+
+    midll::read_manifest(manifest_path, ec);
+    EXPECT_TRUE(ec);
+
+    std::ofstream(manifest_path) << "not a manifest\n";
+    midll::read_manifest(manifest_path, ec);
+    EXPECT_EQ(ec, midll::fs::make_error_code(midll::fs::errc::invalid_argument));
+
+    std::ofstream(manifest_path) << "midll-manifest 1\nload 0 /midll/library_that_does_not_exist.so\nload 0 "
+                                 << midll::fs::absolute(midll::shared_library::decorate("test_library")).string()
+                                 << '\n';
+    const std::vector<midll::shared_library> libs = midll::replay_manifest(manifest_path, ec);
+    EXPECT_TRUE(ec);
+    ASSERT_EQ(libs.size(), 2u);
+    EXPECT_FALSE(libs[0].is_loaded());
+    EXPECT_TRUE(libs[1].is_loaded());
+    EXPECT_THROW(midll::replay_manifest(manifest_path), midll::fs::system_error);
+
+    midll::fs::remove(manifest_path);
+}
@@ -0,0 +1,54 @@
+#include <gtest/gtest.h>
+
+#include <midll/midll.hpp>
+
+#include <algorithm>
+
+#ifdef MIDLL_HAS_MEMORY_USAGE
+
+TEST(test_memory_usage, library)
+{
+    midll::shared_library sl(midll::shared_library::decorate("test_library"));
+    EXPECT_EQ(sl.get<int(int)>("increment")(1), 2);
+    sl.get<int>("integer_g") = 101;
+
+    const midll::library_memory_usage usage = sl.memory_usage();
+    EXPECT_GT(usage.text.rss, 0u);
+    EXPECT_GT(usage.data.rss, 0u);
+    EXPECT_GT(usage.data.private_dirty, 0u);
+    EXPECT_GT(usage.total().pss, 0u);
+    EXPECT_LE(usage.total().pss, usage.total().rss);
+    EXPECT_LE(usage.total().private_dirty, usage.total().rss);
+    sl.get<int>("integer_g") = 100;
+
+    midll::fs::error_code ec;
+    midll::shared_library().memory_usage(ec);
+    EXPECT_EQ(ec, midll::fs::make_error_code(midll::fs::errc::bad_file_descriptor));
+}
+
+TEST(test_memory_usage, report)
+{
+    midll::shared_library sl(midll::shared_library::decorate("test_library"));
+    EXPECT_EQ(sl.get<int(int)>("increment")(1), 2);
+
+    const std::vector<midll::module_memory_usage> report = midll::memory_usage_report();
+    const auto it = std::find_if(report.begin(), report.end(), [&sl](const midll::module_memory_usage& m) {
+        midll::fs::error_code ignore;
+        return midll::fs::equivalent(m.name, sl.location(), ignore);
+    });
+    ASSERT_NE(it, report.end());
+    EXPECT_GT(it->usage.text.rss, 0u);
+    EXPECT_GT(it->usage.total().rss, 0u);
+
+    // The main program and the C++ runtime are reported as well
+    EXPECT_GT(report.size(), 2u);
+    const auto program = std::find_if(report.begin(), report.end(), [](const midll::module_memory_usage& m) {
+        midll::fs::error_code ignore;
+        return midll::fs::equivalent(m.name, midll::program_location(), ignore);
+    });
+    ASSERT_NE(program, report.end());
+    EXPECT_GT(program->usage.text.rss, 0u);
+    EXPECT_GT(program->usage.relro.rss, 0u);
+}
+
+#endif
@@ -0,0 +1,73 @@
+#include <gtest/gtest.h>
+
+#include <midll/midll.hpp>
+
+TEST(test_namespace_pool, namespaces)
+{
+    auto path = midll::fs::absolute(midll::shared_library::decorate("test_library"));
+
+    midll::shared_library base(path);
+    EXPECT_TRUE(base.namespace_id() == midll::link_namespace::base());
+
+    midll::fs::error_code ec;
+    midll::shared_library copy(path, midll::link_namespace::create_new(), ec);
+#ifdef MIDLL_HAS_DLMOPEN
+    ASSERT_FALSE(ec);
+    EXPECT_TRUE(copy.namespace_id() != midll::link_namespace::base());
+    EXPECT_TRUE(copy.native() != base.native());
+
+    // Globals are not shared between namespaces. test_library is never unmapped from the base namespace, so the
+    // value of the base copy is restored for the other tests
+    base.get<int>("integer_g") = 1;
+    copy.get<int>("integer_g") = 2;
+    EXPECT_EQ(base.get<int>("integer_g"), 1);
+    EXPECT_EQ(copy.get<int>("integer_g"), 2);
+    base.get<int>("integer_g") = 100;
+
+    // Copies stay in the namespace of the source
+    midll::shared_library copy2(copy);
+    EXPECT_TRUE(copy2 == copy);
+    EXPECT_TRUE(copy2.namespace_id() == copy.namespace_id());
+#else
+    EXPECT_TRUE(ec);
+    EXPECT_FALSE(copy);
+#endif
+}
+
+TEST(test_namespace_pool, pool)
+{
+    // Namespaces are released only when all their libraries are unmapped. test_library never is, so a plain C
+    // library is used, otherwise the pool would exhaust the namespaces for the other tests
+    auto path = midll::fs::absolute(midll::shared_library::decorate("synthetic_probe"));
+
+    midll::fs::error_code ec;
+    midll::namespace_pool pool(path, 3, ec);
+#ifdef MIDLL_HAS_DLMOPEN
+    ASSERT_FALSE(ec);
+    ASSERT_FALSE(pool.empty());
+    EXPECT_LE(pool.size(), 3u);
+
+    for (std::size_t i = 0; i < pool.size(); ++i) {
+        pool[i].get<int>("synthetic_variable_1") = static_cast<int>(i);
+    }
+    for (std::size_t i = 0; i < pool.size(); ++i) {
+        EXPECT_EQ(pool.for_shard(i + pool.size()).get<int>("synthetic_variable_1"), static_cast<int>(i));
+    }
+
+    midll::namespace_pool huge_pool(path, 1000, ec);
+    EXPECT_FALSE(ec);
+    EXPECT_LT(huge_pool.size(), midll::max_link_namespaces);
+#else
+    EXPECT_TRUE(ec);
+    EXPECT_TRUE(pool.empty());
+#endif
+
+    midll::namespace_pool bad_pool("some/path/that/does/not/exist", 2, ec);
+    EXPECT_TRUE(ec);
+    EXPECT_TRUE(bad_pool.empty());
+
+    midll::namespace_pool zero_pool(path, 0, ec);
+    EXPECT_EQ(ec, midll::fs::make_error_code(midll::fs::errc::invalid_argument));
+    EXPECT_TRUE(zero_pool.empty());
+    EXPECT_THROW(midll::namespace_pool(path, 0), midll::fs::system_error);
+}
@@ -0,0 +1,94 @@
+#include <gtest/gtest.h>
+
+#include <midll/midll.hpp>
+
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace
+{
+MIDLL_INTERFACE(test_api,
+    (increment, int(int))
+    (integer_g, int)
+    (const_integer_g, const int)
+)
+
+MIDLL_INTERFACE(test_alias_api,
+    (foo_bar, std::size_t(const std::vector<int>&))
+    (const_integer_g_alias, const int)
+)
+
+MIDLL_INTERFACE(broken_api,
+    (missing_one, void())
+    (increment, int(int))
+    (missing_two, std::map<int, int>)
+)
+
+struct phase_counter : midll::loader_observer
+{
+    int binds = 0;
+
+    void on_phase(const midll::phase_event& e) noexcept override
+    {
+        if (std::strcmp(e.name, "bind") == 0) {
+            ++binds;
+        }
+    }
+};
+} // namespace
+
+TEST(test_plugin_interface, bind)
+{
+    static_assert(alignof(test_api) == MIDLL_INTERFACE_ALIGNMENT, "interface must be cache line aligned");
+
+    midll::shared_library lib(midll::fs::absolute(midll::shared_library::decorate("test_library")));
+
+    phase_counter observer;
+    midll::set_loader_observer(&observer);
+    const test_api api = lib.bind<test_api>();
+    midll::set_loader_observer(nullptr);
+    EXPECT_EQ(observer.binds, 1);
+
+    EXPECT_EQ(api.increment(1), 2);
+    EXPECT_EQ(api.integer_g, &lib.get<int>("integer_g"));
+    EXPECT_EQ(*api.const_integer_g, 777);
+
+    const test_alias_api aliases = lib.bind_alias<test_alias_api>();
+    EXPECT_EQ(aliases.foo_bar(std::vector<int>{1, 2}), 2u);
+    EXPECT_EQ(*aliases.const_integer_g_alias, 777);
+
+    midll::fs::error_code ec;
+    const test_alias_api aliases2 = lib.bind_alias<test_alias_api>(ec);
+    EXPECT_FALSE(ec);
+    EXPECT_EQ(aliases2.foo_bar, aliases.foo_bar);
+}
+
+TEST(test_plugin_interface, missing)
+{
+    midll::shared_library lib(midll::fs::absolute(midll::shared_library::decorate("test_library")));
+
+    try {
+        lib.bind<broken_api>();
+        ADD_FAILURE() << "exception expected";
+    }
+    catch (const midll::fs::system_error& e) {
+        EXPECT_EQ(e.code(), midll::fs::make_error_code(midll::fs::errc::invalid_seek));
+        const std::string what = e.what();
+        EXPECT_NE(what.find("missing_one, missing_two"), std::string::npos) << what;
+    }
+
+    midll::fs::error_code ec;
+    const broken_api api = lib.bind<broken_api>(ec);
+    EXPECT_EQ(ec, midll::fs::make_error_code(midll::fs::errc::invalid_seek));
+    EXPECT_EQ(api.missing_one, nullptr);
+    EXPECT_EQ(api.missing_two, nullptr);
+    ASSERT_NE(api.increment, nullptr);
+    EXPECT_EQ(api.increment(41), 42);
+
+    midll::shared_library empty;
+    empty.bind<test_api>(ec);
+    EXPECT_EQ(ec, midll::fs::make_error_code(midll::fs::errc::bad_file_descriptor));
+    EXPECT_THROW(empty.bind<test_api>(), midll::fs::system_error);
+}
@@ -0,0 +1,158 @@
+#include <gtest/gtest.h>
+
+#include <midll/midll.hpp>
+
+#ifdef MIDLL_HAS_PLUGIN_WATCHER
+
+#    include <chrono>
+#    include <condition_variable>
+#    include <fstream>
+#    include <mutex>
+#    include <string>
+#    include <vector>
+
+#    include <unistd.h>
+
+TEST(test_plugin_watcher, load_and_errors)
+{
+    const midll::fs::path dir = midll::fs::temp_directory_path() / ("midll_watcher_" + std::to_string(::getpid()));
+    midll::fs::create_directories(dir);
+
+    std::mutex m;
+    std::condition_variable cv;
+    std::shared_ptr<midll::shared_library> loaded;
+    midll::fs::path loaded_path;
+    midll::fs::error_code error;
+    midll::fs::path error_path;
+
+    {
+        midll::plugin_watcher_options options;
+        options.directories = {dir};
+        options.required_symbols = {"synthetic_function_1"};
+        options.debounce = std::chrono::milliseconds(10);
+
+        midll::plugin_watcher watcher(std::move(options));
+        watcher.subscribe([&](const midll::fs::path& p, std::shared_ptr<midll::shared_library> lib) {
+            std::lock_guard<std::mutex> lock(m);
+            loaded_path = p;
+            loaded = std::move(lib);
+            cv.notify_all();
+        });
+        watcher.on_error([&](const midll::fs::path& p, const midll::fs::error_code& ec) {
+            std::lock_guard<std::mutex> lock(m);
+            error_path = p;
+            error = ec;
+            cv.notify_all();
+        });
+
+        const midll::fs::path plugin = dir / midll::shared_library::decorate("plugin");
+        midll::fs::copy_file(midll::shared_library::decorate("synthetic_probe"), plugin);
+        {
+            std::unique_lock<std::mutex> lock(m);
+            ASSERT_TRUE(cv.wait_for(lock, std::chrono::seconds(10), [&]() { return !!loaded; }));
+            EXPECT_EQ(loaded_path, plugin);
+            EXPECT_EQ(loaded->location(), plugin);
+            EXPECT_EQ(loaded->get<int(int)>("synthetic_function_1")(1), 2);
+        }
+
+        const midll::fs::path bad = dir / midll::shared_library::decorate("bad");
+        std::ofstream(bad) << "not a library";
+        {
+            std::unique_lock<std::mutex> lock(m);
+            ASSERT_TRUE(cv.wait_for(lock, std::chrono::seconds(10), [&]() { return !!error; }));
+            EXPECT_EQ(error_path, bad);
+            EXPECT_EQ(error, midll::fs::make_error_code(midll::fs::errc::executable_format_error));
+        }
+
+        // Files with other extensions are ignored
+        std::ofstream(dir / "readme.txt") << "text";
+    }
+
+    midll::fs::remove_all(dir);
+
+    midll::fs::error_code ec;
+    midll::plugin_watcher_options missing;
+    missing.directories = {dir};
+    midll::plugin_watcher watcher(std::move(missing), ec);
+    EXPECT_TRUE(ec);
+}
+
+
+TEST(test_plugin_watcher, reload_while_held)
+{
+    const midll::fs::path dir =
+        midll::fs::temp_directory_path() / ("midll_watcher_reload_" + std::to_string(::getpid()));
+    midll::fs::create_directories(dir);
+
+    std::mutex m;
+    std::condition_variable cv;
+    std::vector<std::shared_ptr<midll::shared_library> > loaded;
+
+    {
+        midll::plugin_watcher_options options;
+        options.directories = {dir};
+        options.debounce = std::chrono::milliseconds(10);
+
+        midll::plugin_watcher watcher(std::move(options));
+        watcher.subscribe([&](const midll::fs::path&, std::shared_ptr<midll::shared_library> lib) {
+            std::lock_guard<std::mutex> lock(m);
+            loaded.push_back(std::move(lib));
+            cv.notify_all();
+        });
+
+        // Each version is written next to the plugin and renamed over it, like the deployment tools do. Plain C
+        // libraries are used: a copy of a C++ library could bind its global objects to the ones of the already
+        // loaded library and destroy them on unload
+        const midll::fs::path plugin = dir / midll::shared_library::decorate("plugin");
+        const midll::fs::path staging = dir / "plugin.tmp";
+        const auto deploy = [&](const char* library) {
+            midll::fs::copy_file(midll::shared_library::decorate(library), staging,
+                                 midll::fs::copy_options::overwrite_existing);
+            midll::fs::rename(staging, plugin);
+        };
+
+        deploy("synthetic_probe");
+        {
+            std::unique_lock<std::mutex> lock(m);
+            ASSERT_TRUE(cv.wait_for(lock, std::chrono::seconds(10), [&]() { return loaded.size() == 1; }));
+            EXPECT_EQ(loaded[0]->location(), plugin);
+            EXPECT_EQ(loaded[0]->get<int(int)>("synthetic_function_1")(1), 2);
+            EXPECT_FALSE(loaded[0]->has("synthetic_function_3"));
+        }
+
+        // The first version is still held while the plugin is rewritten
+        deploy("synthetic_1k");
+        {
+            std::unique_lock<std::mutex> lock(m);
+            ASSERT_TRUE(cv.wait_for(lock, std::chrono::seconds(10), [&]() { return loaded.size() == 2; }));
+            EXPECT_NE(loaded[0]->native(), loaded[1]->native());
+            EXPECT_EQ(loaded[1]->get<int(int)>("synthetic_function_3")(1), 4);
+            EXPECT_EQ(loaded[1]->get<int>("synthetic_variable_7"), 7);
+            EXPECT_EQ(loaded[0]->get<int(int)>("synthetic_function_1")(1), 2);
+
+            // The new version comes from a memory file, the watched directory is not written
+            EXPECT_EQ(loaded[1]->location().parent_path(), "/proc/self/fd");
+        }
+
+        // Once the old version is released, the next one is loaded from the directory again
+        {
+            std::lock_guard<std::mutex> lock(m);
+            loaded.clear();
+        }
+        deploy("synthetic_probe");
+        {
+            std::unique_lock<std::mutex> lock(m);
+            ASSERT_TRUE(cv.wait_for(lock, std::chrono::seconds(10), [&]() { return loaded.size() == 1; }));
+            EXPECT_EQ(loaded[0]->location(), plugin);
+            EXPECT_FALSE(loaded[0]->has("synthetic_function_3"));
+        }
+    }
+
+    // Nothing is written into the watched directory
+    for (const auto& entry : midll::fs::directory_iterator(dir)) {
+        EXPECT_EQ(entry.path().filename(), midll::shared_library::decorate("plugin")) << entry.path();
+    }
+    midll::fs::remove_all(dir);
+}
+
+#endif
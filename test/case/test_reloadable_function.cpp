@@ -0,0 +1,51 @@
+#include <gtest/gtest.h>
+
+#include <midll/midll.hpp>
+
+#include <string>
+
+#include <unistd.h>
+
+TEST(test_reloadable_function, reload)
+{
+    // A plain C library: a copy of a C++ library could bind its global objects to the ones of the loaded library
+    const midll::fs::path path = midll::fs::absolute(midll::shared_library::decorate("synthetic_probe"));
+    const midll::fs::path copy =
+        midll::fs::temp_directory_path() / ("midll_reload_" + std::to_string(::getpid()) + path.extension().string());
+    midll::fs::copy_file(path, copy, midll::fs::copy_options::overwrite_existing);
+
+    {
+        midll::reloadable_function<int(int)> f(path, "synthetic_function_1");
+        EXPECT_EQ(f(1), 2);
+        int (*const old)(int) = f.get();
+
+        auto reader = f.make_reader();
+        reader.quiescent();
+
+        midll::fs::error_code ec;
+        f.reload(path.string() + ".1.1.1", ec);
+        EXPECT_TRUE(ec);
+        EXPECT_EQ(f.get(), old);
+
+        f.reload(copy);
+        EXPECT_NE(f.get(), old);
+        EXPECT_EQ(f(1), 2);
+
+        // Reader has not passed a quiescent state after the reload
+        EXPECT_EQ(f.reclaim(), 1u);
+
+        reader.quiescent();
+        EXPECT_EQ(f.reclaim(), 0u);
+
+        // No readers: old versions are reclaimed on reload
+        {
+            auto moved = std::move(reader);
+        }
+        reader.quiescent(); // moved-from reader does nothing
+        f.reload(path);
+        EXPECT_EQ(f.reclaim(), 0u);
+        EXPECT_EQ(f(41), 42);
+    }
+
+    midll::fs::remove(copy);
+}
@@ -31,7 +31,7 @@ TEST(test_shared_library_get_symbol, refcountable)
 #if defined(__GNUC__) && __GNUC__ >= 4 && defined(__ELF__)
     {
         const int the_answer = midll::import_symbol<int(int)>(path, "protected_function")(0);
-        EXPECT_TRUE(the_answer, 42);
+        EXPECT_EQ(the_answer, 42);
     }
 #endif
 
@@ -144,6 +144,7 @@ TEST(test_shared_library_get_symbol, get_symbol)
 
     EXPECT_TRUE(inc(1) == 2);
     EXPECT_TRUE(sl.get<int>("integer_g") == 200);
+    sl.get<int>("integer_g") = 100;
 
     // test alias
     auto sz = sl.get_alias<std::size_t(const std::vector<int>&)>("foo_bar");
@@ -161,3 +162,103 @@ TEST(test_shared_library_get_symbol, get_symbol)
     int&& rvalue_reference_to_internal_integer = sl.get<int&&>("rvalue_reference_to_internal_integer");
     EXPECT_TRUE(rvalue_reference_to_internal_integer == 0xFF0000);
 }
+
+TEST(test_shared_library_get_symbol, try_get)
+{
+    auto path = midll::shared_library::decorate("test_library");
+    midll::shared_library sl(path);
+
+    midll::fs::error_code ec;
+    int* i = sl.try_get<int>("integer_g", ec);
+    ASSERT_TRUE(i);
+    EXPECT_FALSE(ec);
+    EXPECT_EQ(i, &sl.get<int>("integer_g"));
+
+    EXPECT_TRUE(sl.try_get<increment_func>(std::string("increment")));
+    EXPECT_EQ(sl.try_get<increment_func>("increment")(1), 2);
+    EXPECT_EQ(sl.try_get_alias<const int>("const_integer_g_alias", ec), &sl.get<const int>("const_integer_g"));
+    EXPECT_FALSE(ec);
+
+    EXPECT_EQ(sl.try_get<int>("symbol_that_does_not_exist", ec), nullptr);
+    EXPECT_TRUE(ec);
+    EXPECT_EQ(sl.try_get_alias<int>("alias_that_does_not_exist"), nullptr);
+
+    midll::shared_library empty;
+    EXPECT_EQ(empty.try_get<int>("integer_g", ec), nullptr);
+    EXPECT_EQ(ec, midll::fs::make_error_code(midll::fs::errc::bad_file_descriptor));
+
+    auto inc = midll::try_import_symbol<increment_func>(path, "increment", ec);
+    EXPECT_FALSE(ec);
+    ASSERT_TRUE(inc);
+    EXPECT_EQ(inc(1), 2);
+
+    auto missing = midll::try_import_symbol<increment_func>(sl, "symbol_that_does_not_exist", ec);
+    EXPECT_TRUE(ec);
+    EXPECT_FALSE(missing);
+
+    std::shared_ptr<const int> c = midll::try_import_alias<const int>(sl, "const_integer_g_alias", ec);
+    EXPECT_FALSE(ec);
+    ASSERT_TRUE(c);
+    EXPECT_EQ(*c, 777);
+
+    auto not_loaded = midll::try_import_alias<int>(path.string() + ".1.1.1", "const_integer_g_alias", ec);
+    EXPECT_TRUE(ec);
+    EXPECT_FALSE(not_loaded);
+
+    midll::shared_library moved(path);
+    EXPECT_FALSE(midll::try_import_symbol<int>(std::move(moved), "symbol_that_does_not_exist", ec));
+    EXPECT_TRUE(moved.is_loaded()); // not consumed on a miss
+}
+
+TEST(test_shared_library_get_symbol, import_lazy)
+{
+    // test_library is never unmapped once loaded, so the deferred load is checked on a library that no other test
+    // keeps loaded
+    auto probe = midll::fs::absolute(midll::shared_library::decorate("synthetic_probe"));
+
+    auto inc = midll::import_lazy<increment_func>(probe, "synthetic_function_1");
+    auto inc_copy = inc;
+    EXPECT_FALSE(inc.is_bound());
+    midll::fs::error_code ec;
+    EXPECT_FALSE(midll::shared_library::find_loaded(probe, ec));
+
+    EXPECT_EQ(inc(1), 2);
+    EXPECT_TRUE(inc.is_bound());
+    EXPECT_TRUE(inc_copy.is_bound());
+    EXPECT_EQ(inc_copy(2), 3);
+
+    auto path = midll::fs::absolute(midll::shared_library::decorate("test_library"));
+    std::vector<int> v(10);
+    auto foo_bar = midll::import_alias_lazy<std::size_t(const std::vector<int>&)>(path, "foo_bar");
+    EXPECT_EQ(foo_bar(v), 10u);
+
+    auto missing = midll::import_lazy<increment_func>(path, "symbol_that_does_not_exist");
+    EXPECT_THROW(missing(1), midll::fs::system_error);
+    EXPECT_THROW(missing(1), midll::fs::system_error); // failed binding is retried
+    EXPECT_FALSE(missing.is_bound());
+}
+
+TEST(test_shared_library_get_symbol, borrowed_function)
+{
+    static_assert(std::is_trivially_copyable_v<midll::borrowed_function<increment_func>>);
+
+    auto path = midll::shared_library::decorate("test_library");
+    auto owner = midll::import_symbol<increment_func>(path, "increment");
+
+    midll::borrowed_function<increment_func> f = owner.borrow();
+    ASSERT_TRUE(f);
+    EXPECT_EQ(f(1), 2);
+
+    std::vector<midll::borrowed_function<increment_func>> handles(4, f);
+    for (const auto& h : handles) {
+        EXPECT_EQ(h(2), 3);
+    }
+
+    midll::shared_library sl(path);
+    midll::borrowed_function<increment_func> g = sl.get<increment_func>("increment");
+    EXPECT_EQ(g.get(), f.get());
+
+    midll::borrowed_function<increment_func> empty;
+    EXPECT_FALSE(empty);
+    EXPECT_FALSE(midll::detail::library_function<increment_func>().borrow());
+}
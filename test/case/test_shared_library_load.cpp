@@ -1,10 +1,16 @@
+#include <cstdint>
 #include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <sstream>
+#include <string>
 
 #include <gtest/gtest.h>
 
 #include <midll/midll.hpp>
 
+#include <unistd.h>
+
 auto relpath = midll::shared_library::decorate("test_library");
 auto abspath = std::filesystem::absolute(relpath);
 
@@ -132,7 +138,7 @@ TEST(test_shared_library_load, load_mode)
 #if defined(MIDLL_OS_WINDOWS)
         midll::shared_library sl("winmm.dll", midll::load_mode::search_system_folders);
 #elif defined(MIDLL_OS_LINUX)
-        middll::shared_library sl("libz.so", midll::load_mode::search_system_folders);
+        midll::shared_library sl("libz.so", midll::load_mode::search_system_folders);
 #endif
     }
 
@@ -221,3 +227,238 @@ TEST(test_shared_library_load, load_bad_path)
     EXPECT_TRUE(!sl.is_loaded());
     EXPECT_TRUE(!sl);
 }
+
+TEST(test_shared_library_load, load_program_or_missing)
+{
+    midll::fs::error_code ec;
+    midll::shared_library self(midll::program_location(), ec);
+    EXPECT_FALSE(ec);
+    EXPECT_TRUE(self.is_loaded());
+
+    midll::shared_library self_decorated(midll::program_location(), ec, midll::load_mode::append_decorations);
+    EXPECT_FALSE(ec);
+    EXPECT_TRUE(self_decorated.is_loaded());
+
+    midll::shared_library missing(abspath.parent_path() / "library_that_does_not_exist", ec,
+                                  midll::load_mode::append_decorations);
+    EXPECT_EQ(ec, midll::fs::make_error_code(midll::fs::errc::bad_file_descriptor));
+    EXPECT_FALSE(missing.is_loaded());
+
+    missing.load("library_that_does_not_exist", midll::load_mode::append_decorations, ec);
+    EXPECT_EQ(ec, midll::fs::make_error_code(midll::fs::errc::bad_file_descriptor));
+    EXPECT_FALSE(missing.is_loaded());
+
+    EXPECT_EQ(midll::program_location(), midll::program_location());
+}
+
+TEST(test_shared_library_load, load_program_via_link)
+{
+    // Link to the program under another name, like /usr/bin/python -> python3.x
+    const midll::fs::path link =
+        midll::fs::temp_directory_path() / ("midll_program_link_" + std::to_string(::getpid()));
+    midll::fs::error_code ec;
+    midll::fs::remove(link, ec);
+    midll::fs::create_symlink(midll::program_location(), link);
+
+    midll::shared_library self(link, ec);
+    EXPECT_FALSE(ec) << ec.message();
+    EXPECT_TRUE(self.is_loaded());
+
+    midll::fs::remove(link);
+}
+
+TEST(test_shared_library_load, huge_text)
+{
+    midll::shared_library sl(abspath, midll::load_mode::huge_text | midll::load_mode::rtld_now);
+    EXPECT_TRUE(sl.is_loaded());
+    EXPECT_TRUE(sl.location() == abspath);
+
+    // test_library code is much smaller than a huge page, so nothing is remapped but the library stays usable
+    EXPECT_EQ(sl.huge_text_pages(), 0u);
+    EXPECT_EQ(sl.get<int(int)>("increment")(1), 2);
+
+    midll::shared_library sl2(abspath);
+    EXPECT_EQ(sl2.huge_text_pages(), 0u);
+
+    sl.unload();
+    EXPECT_EQ(sl.huge_text_pages(), 0u);
+}
+
+#if defined(MIDLL_OS_LINUX)
+TEST(test_shared_library_load, huge_text_remap)
+{
+    std::ifstream thp("/sys/kernel/mm/transparent_hugepage/enabled");
+    std::string thp_mode;
+    if (!std::getline(thp, thp_mode) || thp_mode.find("[never]") != std::string::npos) {
+        GTEST_SKIP() << "transparent huge pages are not available";
+    }
+
+    // Functions of synthetic_huge_text are surrounded by 2 MiB of padding, so they lie in a remapped range
+    const auto path = midll::fs::absolute(midll::shared_library::decorate("synthetic_huge_text"));
+    midll::shared_library sl(path, midll::load_mode::huge_text | midll::load_mode::rtld_now);
+    ASSERT_GT(sl.huge_text_pages(), 0u);
+
+    for (int i = 0; i < 500; i += 7) {
+        EXPECT_EQ(sl.get<int(int)>("synthetic_function_" + std::to_string(i))(1), 1 + i);
+    }
+
+    // Remapped code is backed by anonymous memory instead of the file
+    const auto address = reinterpret_cast<std::uintptr_t>(&sl.get<int(int)>("synthetic_function_250"));
+    std::ifstream maps("/proc/self/maps");
+    bool found = false;
+    for (std::string line; std::getline(maps, line);) {
+        std::istringstream fields(line);
+        std::uintptr_t begin = 0;
+        std::uintptr_t end = 0;
+        char dash = 0;
+        std::string perms, offset, device, inode, pathname;
+        fields >> std::hex >> begin >> dash >> end >> perms >> offset >> device >> inode >> pathname;
+        if (begin <= address && address < end) {
+            found = true;
+            EXPECT_EQ(perms.substr(0, 3), "r-x") << line;
+            EXPECT_EQ(pathname.find("synthetic_huge_text"), std::string::npos) << line;
+        }
+    }
+    EXPECT_TRUE(found);
+}
+#endif
+
+TEST(test_shared_library_load, lock_in_memory)
+{
+    midll::fs::error_code ec;
+    midll::shared_library sl;
+    sl.lock_in_memory(ec);
+    EXPECT_TRUE(ec);
+    EXPECT_FALSE(sl.is_locked_in_memory());
+
+    sl.load(abspath);
+    sl.lock_in_memory(ec);
+#if defined(MIDLL_OS_LINUX) || defined(MIDLL_OS_FREEBSD)
+    // Unprivileged processes may have too small RLIMIT_MEMLOCK
+    EXPECT_TRUE(!ec || ec == midll::fs::errc::not_enough_memory);
+    EXPECT_EQ(sl.is_locked_in_memory(), !ec);
+#endif
+    EXPECT_EQ(sl.get<int(int)>("increment")(1), 2);
+
+    sl.unload();
+    EXPECT_FALSE(sl.is_locked_in_memory());
+
+    midll::shared_library sl2(abspath, midll::load_mode::mlock, ec);
+    EXPECT_EQ(sl2.is_loaded(), !ec);
+    if (sl2) {
+        EXPECT_EQ(sl2.get<int(int)>("increment")(1), 2);
+    }
+}
+
+#if defined(MIDLL_OS_LINUX) || defined(MIDLL_OS_FREEBSD)
+TEST(test_shared_library_load, lock_in_memory_nested)
+{
+    const auto path = midll::fs::absolute(midll::shared_library::decorate("synthetic_1k"));
+    midll::shared_library first(path);
+    midll::shared_library second(path);
+
+    midll::fs::error_code ec;
+    first.lock_in_memory(ec);
+    if (ec == midll::fs::errc::not_enough_memory) {
+        GTEST_SKIP() << "RLIMIT_MEMLOCK is too small";
+    }
+    ASSERT_FALSE(ec);
+    second.lock_in_memory(ec);
+    ASSERT_FALSE(ec);
+
+    // Unlocking via one instance keeps the library locked for the other one
+    first.unlock_in_memory();
+    EXPECT_FALSE(first.is_locked_in_memory());
+    EXPECT_TRUE(second.is_locked_in_memory());
+
+    const auto address = reinterpret_cast<std::uintptr_t>(&second.get<int(int)>("synthetic_function_0"));
+    std::ifstream smaps("/proc/self/smaps");
+    bool in_mapping = false;
+    bool found = false;
+    for (std::string line; std::getline(smaps, line);) {
+        std::uintptr_t begin = 0;
+        std::uintptr_t end = 0;
+        char dash = 0;
+        if (std::istringstream(line) >> std::hex >> begin >> dash >> end && dash == '-') {
+            in_mapping = (begin <= address && address < end);
+        }
+        else if (in_mapping && line.compare(0, 7, "Locked:") == 0) {
+            found = true;
+            EXPECT_NE(std::stoul(line.substr(7)), 0u) << line;
+        }
+    }
+    EXPECT_TRUE(found);
+
+    second.unload();
+    EXPECT_FALSE(second.is_locked_in_memory());
+}
+#endif
+
+TEST(test_shared_library_load, find_loaded)
+{
+    // test_library is never unmapped once loaded, so a library that only this test loads is probed
+    const auto probe_relpath = midll::shared_library::decorate("synthetic_probe");
+    const auto probe_abspath = midll::fs::absolute(probe_relpath);
+
+    midll::fs::error_code ec;
+    midll::shared_library not_loaded = midll::shared_library::find_loaded(probe_abspath, ec);
+    EXPECT_TRUE(ec);
+    EXPECT_FALSE(not_loaded);
+
+    {
+        midll::shared_library sl(probe_abspath);
+
+        midll::shared_library found = midll::shared_library::find_loaded(probe_abspath, ec);
+        EXPECT_FALSE(ec);
+        EXPECT_TRUE(found == sl);
+
+        found = midll::shared_library::find_loaded(probe_relpath, ec);
+        EXPECT_FALSE(ec);
+        EXPECT_TRUE(found == sl);
+
+        found = midll::shared_library::find_loaded(probe_abspath.parent_path() / "." / probe_relpath, ec);
+        EXPECT_FALSE(ec);
+        EXPECT_TRUE(found == sl);
+
+        sl.unload();
+        EXPECT_EQ(found.get<int(int)>("synthetic_function_1")(1), 2);
+    }
+
+    not_loaded = midll::shared_library::find_loaded(probe_abspath, ec);
+    EXPECT_TRUE(ec);
+    EXPECT_FALSE(not_loaded);
+
+    not_loaded = midll::shared_library::find_loaded("", ec);
+    EXPECT_TRUE(ec);
+    EXPECT_FALSE(not_loaded);
+}
+
+TEST(test_shared_library_load, deferred_unload)
+{
+    const midll::deferred_unload_stats before = midll::deferred_unload_statistics();
+
+    midll::shared_library sl(abspath, midll::load_mode::deferred_unload);
+    EXPECT_EQ(sl.get<int(int)>("increment")(1), 2);
+
+    midll::shared_library copy(sl);
+    EXPECT_TRUE(copy.is_loaded());
+
+    sl.unload();
+    copy.unload();
+    EXPECT_FALSE(sl.is_loaded());
+    {
+        midll::shared_library scoped(abspath, midll::load_mode::deferred_unload);
+    }
+
+    midll::flush_deferred_unloads();
+    const midll::deferred_unload_stats after = midll::deferred_unload_statistics();
+    EXPECT_EQ(after.queue_depth, 0u);
+    EXPECT_EQ(after.reaped - before.reaped, 3u);
+    EXPECT_GE(after.max_latency, before.max_latency);
+
+    // Libraries without the flag are unloaded in place
+    midll::shared_library sync(abspath);
+    sync.unload();
+    midll::flush_deferred_unloads();
+    EXPECT_EQ(midll::deferred_unload_statistics().reaped, after.reaped);
+}
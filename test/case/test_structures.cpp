@@ -9,7 +9,7 @@
 
 #if defined(MIDLL_OS_WINDOWS)
 #    include <windows.h>
-#elif defined(MIDLL_OS_MACOS || MIDLL_OS_IOS)
+#elif defined(MIDLL_OS_MACOS) || defined(MIDLL_OS_IOS)
 #    include <mach-o/loader.h>
 #    include <mach-o/nlist.h>
 #elif defined(MIDLL_OS_QNX)
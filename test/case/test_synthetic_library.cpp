@@ -0,0 +1,40 @@
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <midll/library_info.hpp>
+#include <midll/shared_library.hpp>
+
+TEST(test_synthetic_library, library_info)
+{
+    midll::library_info info(midll::shared_library::decorate("synthetic_1k"));
+
+    const std::vector<std::string> sec = info.sections();
+    for (const char* name : {"synth0", "synth1", "synth2", "synth3"}) {
+        EXPECT_TRUE(std::find(sec.begin(), sec.end(), name) != sec.end()) << name;
+    }
+
+    std::vector<std::string> sym = info.symbols();
+    const auto synthetic = std::count_if(sym.begin(), sym.end(), [](const std::string& s) {
+        return s.compare(0, 10, "synthetic_") == 0;
+    });
+    EXPECT_EQ(synthetic, 1000);
+
+    // Variables are spread over the sections round robin
+    sym = info.symbols("synth1");
+    EXPECT_EQ(sym.size(), 125u);
+    EXPECT_TRUE(std::find(sym.begin(), sym.end(), "synthetic_variable_1") != sym.end());
+    EXPECT_TRUE(std::find(sym.begin(), sym.end(), "synthetic_variable_497") != sym.end());
+    EXPECT_TRUE(std::find(sym.begin(), sym.end(), "synthetic_variable_0") == sym.end());
+}
+
+TEST(test_synthetic_library, lookup)
+{
+    midll::shared_library sl(midll::shared_library::decorate("synthetic_1k"));
+    EXPECT_EQ(sl.get<int(int)>("synthetic_function_0")(1), 1);
+    EXPECT_EQ(sl.get<int(int)>("synthetic_function_499")(1), 500);
+    EXPECT_EQ(sl.get<int>("synthetic_variable_250"), 250);
+    EXPECT_FALSE(sl.has("synthetic_function_500"));
+}
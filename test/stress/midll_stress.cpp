@@ -0,0 +1,230 @@
+// Copyright Antony Polukhin, 2015-2024.
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+// Contention harness: threads concurrently load, copy, look up symbols in and unload a shared pool of libraries
+// through shared_library and import_symbol. For each thread count from 1 up to --max-threads prints throughput and
+// latency percentiles of the operations. Exits with a non-zero code if any operation returned a wrong result.
+//
+// Usage: midll_stress [--max-threads N] [--duration-ms MS]
+
+#include <midll/midll.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+using clock_type = std::chrono::steady_clock;
+
+struct pooled_library
+{
+    midll::fs::path path;
+    const char* variable; // Name of an `int` variable
+    int value;            // Value of the variable
+    const char* function; // Name of an `int(int)` function
+    int result;           // Value that the function returns for 1
+};
+
+enum operation
+{
+    op_load,
+    op_copy,
+    op_get,
+    op_import,
+    op_unload,
+    op_count
+};
+
+const char* const operation_names[op_count] = {"load", "copy", "get", "import", "unload"};
+
+struct thread_result
+{
+    std::vector<std::uint32_t> latencies[op_count]; // nanoseconds
+    std::uint64_t errors = 0;
+};
+
+struct xorshift
+{
+    std::uint64_t state;
+
+    std::uint32_t operator()() noexcept
+    {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return static_cast<std::uint32_t>(state >> 32);
+    }
+};
+
+void worker(const std::vector<pooled_library>& pool, const std::atomic<bool>& stop, unsigned seed,
+            thread_result& result)
+{
+    constexpr std::size_t max_held = 4;
+    std::vector<std::pair<midll::shared_library, const pooled_library*> > held;
+    held.reserve(max_held + 1);
+    xorshift random{0x9E3779B97F4A7C15ull * (seed + 1)};
+
+    while (!stop.load(std::memory_order_relaxed)) {
+        operation op = static_cast<operation>(random() % op_count);
+        if (held.empty()) {
+            op = op_load;
+        }
+        else if (held.size() >= max_held && (op == op_load || op == op_copy)) {
+            op = op_unload;
+        }
+
+        auto* const slot = (held.empty() ? nullptr : &held[random() % held.size()]);
+        const pooled_library& lib = pool[random() % pool.size()];
+        bool ok = true;
+
+        const clock_type::time_point start = clock_type::now();
+        switch (op) {
+            case op_load: {
+                midll::fs::error_code ec;
+                midll::shared_library sl(lib.path, ec);
+                ok = !ec;
+                if (ok) {
+                    held.emplace_back(std::move(sl), &lib);
+                }
+                break;
+            }
+            case op_copy:
+                held.emplace_back(*slot);
+                break;
+            case op_get: {
+                const int* const v = slot->first.try_get<int>(slot->second->variable);
+                ok = (v && *v == slot->second->value);
+                break;
+            }
+            case op_import: {
+                midll::fs::error_code ec;
+                const auto f = midll::try_import_symbol<int(int)>(slot->first, slot->second->function, ec);
+                ok = (f && f(1) == slot->second->result);
+                break;
+            }
+            case op_unload:
+                std::swap(*slot, held.back());
+                held.pop_back();
+                break;
+            case op_count:
+                break;
+        }
+        const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(clock_type::now() - start).count();
+
+        const auto capped = (std::min)(ns, static_cast<std::chrono::nanoseconds::rep>(UINT32_MAX));
+        result.latencies[op].push_back(static_cast<std::uint32_t>(capped));
+        result.errors += !ok;
+    }
+}
+
+double percentile(const std::vector<std::uint32_t>& sorted, double p)
+{
+    if (sorted.empty()) {
+        return 0;
+    }
+    const std::size_t index = static_cast<std::size_t>(p * static_cast<double>(sorted.size() - 1) + 0.5);
+    return static_cast<double>(sorted[index]) / 1000.0;
+}
+
+void print_row(unsigned threads, const char* name, std::vector<std::uint32_t>& latencies, double seconds)
+{
+    std::sort(latencies.begin(), latencies.end());
+    std::printf("%7u  %-7s %12.0f %10.2f %10.2f %10.2f %10.2f %10.2f\n", threads, name,
+                static_cast<double>(latencies.size()) / seconds, percentile(latencies, 0.5),
+                percentile(latencies, 0.9), percentile(latencies, 0.99), percentile(latencies, 0.999),
+                percentile(latencies, 1.0));
+}
+
+std::uint64_t run(const std::vector<pooled_library>& pool, unsigned threads, std::chrono::milliseconds duration)
+{
+    std::vector<thread_result> results(threads);
+    std::atomic<bool> stop{false};
+
+    std::vector<std::thread> workers;
+    const clock_type::time_point start = clock_type::now();
+    for (unsigned i = 0; i < threads; ++i) {
+        workers.emplace_back(worker, std::cref(pool), std::cref(stop), i, std::ref(results[i]));
+    }
+    std::this_thread::sleep_for(duration);
+    stop.store(true);
+    for (std::thread& t : workers) {
+        t.join();
+    }
+    const double seconds = std::chrono::duration<double>(clock_type::now() - start).count();
+
+    std::uint64_t errors = 0;
+    std::vector<std::uint32_t> all;
+    for (int op = 0; op < op_count; ++op) {
+        std::vector<std::uint32_t> merged;
+        for (thread_result& r : results) {
+            merged.insert(merged.end(), r.latencies[op].begin(), r.latencies[op].end());
+        }
+        all.insert(all.end(), merged.begin(), merged.end());
+        print_row(threads, operation_names[op], merged, seconds);
+    }
+    print_row(threads, "all", all, seconds);
+
+    for (const thread_result& r : results) {
+        errors += r.errors;
+    }
+    return errors;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    unsigned max_threads = std::thread::hardware_concurrency();
+    long duration_ms = 1000;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (!std::strcmp(argv[i], "--max-threads")) {
+            max_threads = static_cast<unsigned>(std::strtoul(argv[i + 1], nullptr, 10));
+        }
+        else if (!std::strcmp(argv[i], "--duration-ms")) {
+            duration_ms = std::strtol(argv[i + 1], nullptr, 10);
+        }
+        else {
+            std::fprintf(stderr, "Usage: %s [--max-threads N] [--duration-ms MS]\n", argv[0]);
+            return 2;
+        }
+    }
+    max_threads = (max_threads ? max_threads : 1);
+
+    const midll::fs::path dir = midll::program_location().parent_path();
+    const std::vector<pooled_library> pool = {
+        {dir / midll::shared_library::decorate("test_library"), "integer_g", 100, "increment", 2},
+        {dir / midll::shared_library::decorate("synthetic_1k"), "synthetic_variable_7", 7, "synthetic_function_7", 8},
+        {dir / midll::shared_library::decorate("synthetic_1k"), "synthetic_variable_499", 499,
+         "synthetic_function_499", 500},
+    };
+
+    std::printf("%7s  %-7s %12s %10s %10s %10s %10s %10s\n", "threads", "op", "ops/s", "p50 us", "p90 us", "p99 us",
+                "p99.9 us", "max us");
+
+    std::uint64_t errors = 0;
+    for (unsigned threads = 1;; threads *= 2) {
+        threads = (std::min)(threads, max_threads);
+        errors += run(pool, threads, std::chrono::milliseconds(duration_ms));
+        if (threads == max_threads) {
+            break;
+        }
+    }
+
+    if (errors) {
+        std::fprintf(stderr, "%llu operations returned wrong results\n", static_cast<unsigned long long>(errors));
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,553 @@
+// Copyright Antony Polukhin, 2015-2024.
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt
+// or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+// Compares two Google Benchmark JSON outputs (--benchmark_format=json or --benchmark_out=file.json) and exits with
+// a non-zero code if any benchmark of the contender is slower than the baseline by more than its threshold.
+//
+// Usage: midll_bench_compare <baseline.json> <contender.json> [--metric real_time|cpu_time] [--threshold PERCENT]
+//                            [--thresholds FILE] [--allow-missing]
+//
+// FILE contains lines "<pattern> <percent>", where '*' in the pattern matches any characters. The first matching
+// line sets the threshold of a benchmark, benchmarks that match no line use --threshold (5% by default). Lines that
+// start with '#' are ignored. Benchmarks that were run with repetitions are compared by the median of the runs, or
+// by the "median" aggregate if only the aggregates were reported (--benchmark_report_aggregates_only=true).
+//
+// Baseline benchmarks that are missing from the contender (for example because they failed) and a comparison
+// without any common benchmarks are failures, unless --allow-missing is passed.
+//
+// Exit codes: 0 no regressions, 1 regressions or missing benchmarks found, 2 invalid arguments or input.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace
+{
+
+// Minimal JSON document model, enough for the benchmark output
+struct json_value
+{
+    enum kind_t
+    {
+        null,
+        boolean,
+        number,
+        string,
+        array,
+        object
+    };
+
+    kind_t kind = null;
+    bool b = false;
+    double n = 0;
+    std::string s;
+    std::vector<json_value> items;
+    std::vector<std::pair<std::string, json_value> > members;
+
+    const json_value* find(const char* key) const
+    {
+        for (const auto& m : members) {
+            if (m.first == key) {
+                return &m.second;
+            }
+        }
+        return nullptr;
+    }
+};
+
+class json_parser
+{
+    const std::string& text_;
+    std::size_t pos_ = 0;
+
+    [[noreturn]] void fail(const char* what) const
+    {
+        throw std::runtime_error(std::string("JSON error at offset ") + std::to_string(pos_) + ": " + what);
+    }
+
+    void skip_spaces()
+    {
+        while (pos_ < text_.size() && std::strchr(" \t\r\n", text_[pos_])) {
+            ++pos_;
+        }
+    }
+
+    char peek()
+    {
+        skip_spaces();
+        if (pos_ >= text_.size()) {
+            fail("unexpected end");
+        }
+        return text_[pos_];
+    }
+
+    void expect(char c)
+    {
+        if (peek() != c) {
+            fail("unexpected character");
+        }
+        ++pos_;
+    }
+
+    bool consume_literal(const char* literal)
+    {
+        const std::size_t size = std::strlen(literal);
+        if (text_.compare(pos_, size, literal) != 0) {
+            return false;
+        }
+        pos_ += size;
+        return true;
+    }
+
+    static void append_utf8(std::string& out, unsigned long cp)
+    {
+        if (cp < 0x80) {
+            out += static_cast<char>(cp);
+        }
+        else if (cp < 0x800) {
+            out += static_cast<char>(0xC0 | (cp >> 6));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        }
+        else {
+            out += static_cast<char>(0xE0 | (cp >> 12));
+            out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        }
+    }
+
+    std::string parse_string()
+    {
+        expect('"');
+        std::string result;
+        while (pos_ < text_.size() && text_[pos_] != '"') {
+            char c = text_[pos_++];
+            if (c != '\\') {
+                result += c;
+                continue;
+            }
+            if (pos_ >= text_.size()) {
+                fail("unterminated escape");
+            }
+            c = text_[pos_++];
+            switch (c) {
+                case 'n':
+                    result += '\n';
+                    break;
+                case 't':
+                    result += '\t';
+                    break;
+                case 'r':
+                    result += '\r';
+                    break;
+                case 'b':
+                    result += '\b';
+                    break;
+                case 'f':
+                    result += '\f';
+                    break;
+                case 'u':
+                    if (pos_ + 4 > text_.size()) {
+                        fail("bad unicode escape");
+                    }
+                    append_utf8(result, std::strtoul(text_.substr(pos_, 4).c_str(), nullptr, 16));
+                    pos_ += 4;
+                    break;
+                default:
+                    result += c;
+            }
+        }
+        if (pos_ >= text_.size()) {
+            fail("unterminated string");
+        }
+        ++pos_;
+        return result;
+    }
+
+    json_value parse_value()
+    {
+        json_value v;
+        const char c = peek();
+        if (c == '{') {
+            ++pos_;
+            v.kind = json_value::object;
+            if (peek() == '}') {
+                ++pos_;
+                return v;
+            }
+            for (;;) {
+                std::string key = parse_string();
+                expect(':');
+                v.members.emplace_back(std::move(key), parse_value());
+                if (peek() == ',') {
+                    ++pos_;
+                    continue;
+                }
+                expect('}');
+                return v;
+            }
+        }
+        if (c == '[') {
+            ++pos_;
+            v.kind = json_value::array;
+            if (peek() == ']') {
+                ++pos_;
+                return v;
+            }
+            for (;;) {
+                v.items.push_back(parse_value());
+                if (peek() == ',') {
+                    ++pos_;
+                    continue;
+                }
+                expect(']');
+                return v;
+            }
+        }
+        if (c == '"') {
+            v.kind = json_value::string;
+            v.s = parse_string();
+            return v;
+        }
+        if (consume_literal("true")) {
+            v.kind = json_value::boolean;
+            v.b = true;
+            return v;
+        }
+        if (consume_literal("false")) {
+            v.kind = json_value::boolean;
+            return v;
+        }
+        if (consume_literal("null")) {
+            return v;
+        }
+
+        // Google Benchmark writes NaN and Infinity for some counters
+        if (consume_literal("NaN") || consume_literal("-NaN")) {
+            v.kind = json_value::number;
+            v.n = NAN;
+            return v;
+        }
+        if (consume_literal("Infinity")) {
+            v.kind = json_value::number;
+            v.n = INFINITY;
+            return v;
+        }
+        if (consume_literal("-Infinity")) {
+            v.kind = json_value::number;
+            v.n = -INFINITY;
+            return v;
+        }
+
+        char* end = nullptr;
+        v.n = std::strtod(text_.c_str() + pos_, &end);
+        if (end == text_.c_str() + pos_) {
+            fail("unexpected character");
+        }
+        v.kind = json_value::number;
+        pos_ = static_cast<std::size_t>(end - text_.c_str());
+        return v;
+    }
+
+public:
+    explicit json_parser(const std::string& text)
+        : text_(text)
+    {
+    }
+
+    json_value parse()
+    {
+        json_value v = parse_value();
+        skip_spaces();
+        if (pos_ != text_.size()) {
+            fail("trailing characters");
+        }
+        return v;
+    }
+};
+
+std::string read_file(const std::string& path)
+{
+    std::ifstream in(path, std::ios_base::binary);
+    if (!in) {
+        throw std::runtime_error("cannot open " + path);
+    }
+    std::ostringstream ss;
+    ss << in.rdbuf();
+    return ss.str();
+}
+
+double to_nanoseconds(double value, const json_value* unit)
+{
+    if (!unit || unit->s == "ns") {
+        return value;
+    }
+    if (unit->s == "us") {
+        return value * 1e3;
+    }
+    if (unit->s == "ms") {
+        return value * 1e6;
+    }
+    if (unit->s == "s") {
+        return value * 1e9;
+    }
+    throw std::runtime_error("unknown time_unit " + unit->s);
+}
+
+// Benchmark name -> median time in nanoseconds, in the order of the first appearance
+std::vector<std::pair<std::string, double> > load_results(const std::string& path, const char* metric)
+{
+    const std::string text = read_file(path);
+    const json_value root = json_parser(text).parse();
+    const json_value* benchmarks = root.find("benchmarks");
+    if (!benchmarks || benchmarks->kind != json_value::array) {
+        throw std::runtime_error(path + " has no \"benchmarks\" array");
+    }
+
+    std::vector<std::string> order;
+    std::map<std::string, std::vector<double> > runs;
+    std::map<std::string, double> medians; // "median" aggregates, used when there are no iteration runs
+    for (const json_value& b : benchmarks->items) {
+        const json_value* run_type = b.find("run_type");
+        const json_value* name = b.find("run_name") ? b.find("run_name") : b.find("name");
+        const json_value* time = b.find(metric);
+        if (!name || !time || time->kind != json_value::number) {
+            continue;
+        }
+        if (b.find("error_occurred") && b.find("error_occurred")->b) {
+            continue;
+        }
+
+        const bool aggregate = (run_type && run_type->s == "aggregate");
+        const json_value* aggregate_name = b.find("aggregate_name");
+        if (aggregate && (!aggregate_name || aggregate_name->s != "median")) {
+            continue;
+        }
+
+        if (runs.find(name->s) == runs.end() && medians.find(name->s) == medians.end()) {
+            order.push_back(name->s);
+        }
+        const double ns = to_nanoseconds(time->n, b.find("time_unit"));
+        if (aggregate) {
+            medians[name->s] = ns;
+        }
+        else {
+            runs[name->s].push_back(ns);
+        }
+    }
+
+    std::vector<std::pair<std::string, double> > result;
+    for (const std::string& name : order) {
+        const auto it = runs.find(name);
+        if (it == runs.end()) {
+            result.emplace_back(name, medians[name]);
+            continue;
+        }
+
+        std::vector<double>& r = it->second;
+        std::sort(r.begin(), r.end());
+        const std::size_t mid = r.size() / 2;
+        result.emplace_back(name, (r.size() % 2 ? r[mid] : (r[mid - 1] + r[mid]) / 2));
+    }
+    return result;
+}
+
+bool glob_match(const char* pattern, const char* text)
+{
+    if (*pattern == '\0') {
+        return *text == '\0';
+    }
+    if (*pattern == '*') {
+        return glob_match(pattern + 1, text) || (*text && glob_match(pattern, text + 1));
+    }
+    return *text == *pattern && glob_match(pattern + 1, text + 1);
+}
+
+std::vector<std::pair<std::string, double> > load_thresholds(const std::string& path)
+{
+    std::vector<std::pair<std::string, double> > result;
+    std::istringstream in(read_file(path));
+    std::string line;
+    while (std::getline(in, line)) {
+        std::istringstream fields(line);
+        std::string pattern;
+        double percent = 0;
+        if (!(fields >> pattern) || pattern[0] == '#') {
+            continue;
+        }
+        if (!(fields >> percent) || percent < 0) {
+            throw std::runtime_error("bad threshold line in " + path + ": " + line);
+        }
+        result.emplace_back(pattern, percent);
+    }
+    return result;
+}
+
+std::string format_time(double ns)
+{
+    const char* unit = "ns";
+    if (ns >= 1e9) {
+        ns /= 1e9;
+        unit = "s";
+    }
+    else if (ns >= 1e6) {
+        ns /= 1e6;
+        unit = "ms";
+    }
+    else if (ns >= 1e3) {
+        ns /= 1e3;
+        unit = "us";
+    }
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%.2f %s", ns, unit);
+    return buffer;
+}
+
+int usage(const char* argv0)
+{
+    std::fprintf(stderr,
+                 "Usage: %s <baseline.json> <contender.json> [--metric real_time|cpu_time] [--threshold PERCENT] "
+                 "[--thresholds FILE] [--allow-missing]\n",
+                 argv0);
+    return 2;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    if (argc < 3) {
+        return usage(argv[0]);
+    }
+
+    const char* metric = "real_time";
+    double default_threshold = 5.0;
+    std::string thresholds_path;
+    bool allow_missing = false;
+    for (int i = 3; i < argc; i += 2) {
+        if (!std::strcmp(argv[i], "--allow-missing")) {
+            allow_missing = true;
+            --i;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            return usage(argv[0]);
+        }
+        if (!std::strcmp(argv[i], "--metric") &&
+            (!std::strcmp(argv[i + 1], "real_time") || !std::strcmp(argv[i + 1], "cpu_time"))) {
+            metric = argv[i + 1];
+        }
+        else if (!std::strcmp(argv[i], "--threshold")) {
+            char* end = nullptr;
+            default_threshold = std::strtod(argv[i + 1], &end);
+            if (end == argv[i + 1] || *end != '\0' || !std::isfinite(default_threshold) || default_threshold < 0) {
+                std::fprintf(stderr, "midll_bench_compare: bad --threshold value %s\n", argv[i + 1]);
+                return 2;
+            }
+        }
+        else if (!std::strcmp(argv[i], "--thresholds")) {
+            thresholds_path = argv[i + 1];
+        }
+        else {
+            return usage(argv[0]);
+        }
+    }
+
+    std::vector<std::pair<std::string, double> > baseline;
+    std::vector<std::pair<std::string, double> > contender;
+    std::vector<std::pair<std::string, double> > thresholds;
+    try {
+        baseline = load_results(argv[1], metric);
+        contender = load_results(argv[2], metric);
+        if (!thresholds_path.empty()) {
+            thresholds = load_thresholds(thresholds_path);
+        }
+    }
+    catch (const std::exception& e) {
+        std::fprintf(stderr, "midll_bench_compare: %s\n", e.what());
+        return 2;
+    }
+
+    std::size_t width = 9;
+    for (const auto& b : baseline) {
+        width = (std::max)(width, b.first.size());
+    }
+    for (const auto& c : contender) {
+        width = (std::max)(width, c.first.size());
+    }
+
+    const int w = static_cast<int>(width);
+    std::printf("%-*s %14s %14s %9s %9s  %s\n", w, "benchmark", "baseline", "contender", "change", "threshold",
+                "status");
+
+    std::size_t regressions = 0;
+    std::size_t compared = 0;
+    std::size_t missing = 0;
+    for (const auto& c : contender) {
+        double threshold = default_threshold;
+        for (const auto& t : thresholds) {
+            if (glob_match(t.first.c_str(), c.first.c_str())) {
+                threshold = t.second;
+                break;
+            }
+        }
+
+        const auto b = std::find_if(baseline.begin(), baseline.end(),
+                                    [&c](const std::pair<std::string, double>& x) { return x.first == c.first; });
+        if (b == baseline.end()) {
+            std::printf("%-*s %14s %14s %9s %8.1f%%  %s\n", w, c.first.c_str(), "-", format_time(c.second).c_str(),
+                        "-", threshold, "NEW");
+            continue;
+        }
+
+        ++compared;
+        const double change = (b->second > 0 ? (c.second - b->second) / b->second * 100.0 : 0.0);
+        const char* status = "OK";
+        if (change > threshold) {
+            status = "REGRESSION";
+            ++regressions;
+        }
+        else if (change < -threshold) {
+            status = "IMPROVED";
+        }
+        std::printf("%-*s %14s %14s %+8.1f%% %8.1f%%  %s\n", w, c.first.c_str(), format_time(b->second).c_str(),
+                    format_time(c.second).c_str(), change, threshold, status);
+    }
+
+    for (const auto& b : baseline) {
+        const auto c = std::find_if(contender.begin(), contender.end(),
+                                    [&b](const std::pair<std::string, double>& x) { return x.first == b.first; });
+        if (c == contender.end()) {
+            std::printf("%-*s %14s %14s %9s %9s  %s\n", w, b.first.c_str(), format_time(b.second).c_str(), "-", "-",
+                        "-", "MISSING");
+            ++missing;
+        }
+    }
+
+    int result = 0;
+    if (regressions) {
+        std::printf("\n%zu regression(s) found\n", regressions);
+        result = 1;
+    }
+    if (missing && !allow_missing) {
+        std::printf("\n%zu benchmark(s) missing from the contender\n", missing);
+        result = 1;
+    }
+    if (!compared && !allow_missing) {
+        std::printf("\nno benchmarks were compared\n");
+        result = 1;
+    }
+    return result;
+}